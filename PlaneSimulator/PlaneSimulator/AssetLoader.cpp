@@ -0,0 +1,144 @@
+#include "AssetLoader.h"
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace
+{
+    std::string fileName(const std::string& path)
+    {
+        return path.substr(path.find_last_of("\\/") + 1);
+    }
+}
+
+AssetLoader::AssetLoader(ThreadPool& pool)
+    : pool(pool)
+{
+}
+
+void AssetLoader::begin()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (outstanding == 0)
+        startTime = Clock::now();
+    outstanding++;
+}
+
+void AssetLoader::enqueueUpload(std::function<void()> upload)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uploads.push_back(std::move(upload));
+    }
+    uploadReady.notify_one();
+}
+
+void AssetLoader::LoadModel(const std::string& path, ModelHandle& target, const ModelLoadOptions& options)
+{
+    if (ModelHandle existing = ModelCache::Get().Find(path, options))
+    {
+        target = existing;
+        return;
+    }
+
+    const std::string key = ModelCache::MakeKey(path, options);
+    auto pending = pendingModels.find(key);
+    if (pending != pendingModels.end())
+    {
+        pending->second.push_back(&target);
+        return;
+    }
+    pendingModels[key].push_back(&target);
+
+    begin();
+    pool.Submit([this, path, key, options]()
+    {
+        std::shared_ptr<ModelData> data = std::make_shared<ModelData>(Model::Import(path, options));
+
+        enqueueUpload([this, path, key, options, data]()
+        {
+            Clock::time_point start = Clock::now();
+            ModelHandle model = ModelCache::Get().Adopt(path, options, new Model(*data));
+            double uploadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            for (ModelHandle* target : pendingModels[key])
+                *target = model;
+            pendingModels.erase(key);
+
+            timings.push_back({ fileName(path), data->cache ? "cache" : "assimp", data->importMs, data->decodeMs, uploadMs, model->GpuBytes() });
+        });
+    });
+}
+
+void AssetLoader::LoadTexture(const std::string& path, unsigned int& target, const TextureParams& params)
+{
+    unsigned int* slot = &target;
+
+    begin();
+    const bool preferCooked = CompressedTexturesSupported();
+    pool.Submit([this, path, params, slot, preferCooked]()
+    {
+        Clock::time_point start = Clock::now();
+        std::shared_ptr<CompressedImage> compressed = std::make_shared<CompressedImage>();
+        std::shared_ptr<ImageData> image = std::make_shared<ImageData>();
+        bool cooked = preferCooked && IsCookedTextureCurrent(path) && compressed->Load(CookedTexturePath(path));
+        if (!cooked && !image->Load(path))
+            std::cout << "Failed to load texture: " << path << std::endl;
+        double decodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        enqueueUpload([this, path, params, slot, compressed, image, cooked, decodeMs]()
+        {
+            Clock::time_point start = Clock::now();
+            *slot = cooked ? UploadCompressedTexture(*compressed, params) : UploadTexture(*image, params);
+            double uploadMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            timings.push_back({ fileName(path), cooked ? "ktx" : "image", 0.0, decodeMs, uploadMs, 0 });
+        });
+    });
+}
+
+void AssetLoader::Finish()
+{
+    for (;;)
+    {
+        std::function<void()> upload;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (outstanding == 0)
+                break;
+            uploadReady.wait(lock, [this] { return !uploads.empty(); });
+            upload = std::move(uploads.front());
+            uploads.pop_front();
+        }
+
+        upload();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--outstanding == 0)
+            wallMs = std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+    }
+}
+
+void AssetLoader::PrintReport() const
+{
+    double importMs = 0.0, decodeMs = 0.0, uploadMs = 0.0;
+    size_t gpuBytes = 0;
+
+    std::cout << "ASSET LOAD REPORT (ms)" << std::endl;
+    std::cout << std::setw(10) << "import" << std::setw(10) << "decode" << std::setw(10) << "upload" << std::setw(10) << "GPU KB"
+        << std::setw(8) << "source" << "  asset" << std::endl;
+    for (const AssetTiming& timing : timings)
+    {
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(10) << timing.importMs << std::setw(10) << timing.decodeMs << std::setw(10) << timing.uploadMs
+            << std::setw(10) << timing.gpuBytes / 1024 << std::setw(8) << timing.source << "  " << timing.name << std::endl;
+        importMs += timing.importMs;
+        decodeMs += timing.decodeMs;
+        uploadMs += timing.uploadMs;
+        gpuBytes += timing.gpuBytes;
+    }
+    std::cout << std::setw(10) << importMs << std::setw(10) << decodeMs << std::setw(10) << uploadMs << std::setw(10) << gpuBytes / 1024
+        << "          total" << std::endl;
+    std::cout << "Wall time " << wallMs << " ms on " << pool.ThreadCount() << " worker threads" << std::endl;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ModelCache.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// Loads models and textures on a worker pool. Workers do the CPU-bound part
+// (Assimp import or mesh cache mapping, stb_image decoding) and queue the GL
+// part (buffer and texture creation), which Finish() runs on the GL thread.
+class AssetLoader
+{
+public:
+    explicit AssetLoader(ThreadPool& pool = ThreadPool::Shared());
+
+    // target is assigned during Finish(); requests for the same asset share one load.
+    void LoadModel(const std::string& path, ModelHandle& target, const ModelLoadOptions& options = ModelLoadOptions());
+    void LoadTexture(const std::string& path, unsigned int& target, const TextureParams& params = TextureParams());
+
+    // Runs queued uploads on the calling thread until every request is filled.
+    void Finish();
+
+    // Per-asset import/decode/upload times and the wall time of the whole batch.
+    void PrintReport() const;
+
+private:
+    typedef std::chrono::high_resolution_clock Clock;
+
+    struct AssetTiming
+    {
+        std::string name;
+        const char* source;
+        double importMs;
+        double decodeMs;
+        double uploadMs;
+        // Vertex and index buffers of models; 0 for textures.
+        size_t gpuBytes;
+    };
+
+    void begin();
+    void enqueueUpload(std::function<void()> upload);
+
+    ThreadPool& pool;
+
+    std::mutex mutex;
+    std::condition_variable uploadReady;
+    std::deque<std::function<void()>> uploads;
+    size_t outstanding = 0;
+
+    // Only touched on the GL thread.
+    std::unordered_map<std::string, std::vector<ModelHandle*>> pendingModels;
+    std::vector<AssetTiming> timings;
+    Clock::time_point startTime;
+    double wallMs = 0.0;
+};
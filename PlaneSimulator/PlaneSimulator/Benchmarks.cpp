@@ -0,0 +1,291 @@
+#include "Benchmarks.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "MTLLoader.h"
+#include "MappedFile.h"
+#include "Model.h"
+#include "ParticleSystem.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    double elapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    double timeModelLoad(const std::string& path, bool useObjImporter, bool useMeshCache)
+    {
+        ModelLoadOptions options;
+        options.useObjImporter = useObjImporter;
+        options.useMeshCache = useMeshCache;
+        options.streamTextures = false;
+
+        Clock::time_point start = Clock::now();
+        Model model(path, options);
+        glFinish();
+        return elapsedMs(start);
+    }
+
+    // Best CPU import time of a few runs, without the mesh cache, texture decoding, optimization, LODs or meshlets.
+    double timeModelImport(const std::string& path, bool useObjImporter, size_t& triangles)
+    {
+        ModelLoadOptions options;
+        options.useMeshCache = false;
+        options.streamTextures = true;
+        options.optimizeMeshes = false;
+        options.generateLods = false;
+        options.buildMeshlets = false;
+        options.useObjImporter = useObjImporter;
+
+        double best = 0.0;
+        for (int run = 0; run < 3; run++)
+        {
+            ModelData data = Model::Import(path, options);
+            triangles = 0;
+            for (const MeshData& mesh : data.meshes)
+                triangles += mesh.indices.size() / 3;
+            if (run == 0 || data.importMs < best)
+                best = data.importMs;
+        }
+        return best;
+    }
+
+    // The loader MaterialLibrary replaced, kept as the baseline. It only knew
+    // newmtl/Ka/Kd/Ks; reads from fin instead of opening the file itself.
+    std::vector<Material> legacyLoadMTL(std::istream& fin)
+    {
+        int pos = -1;
+        std::vector<Material> materials;
+        std::stringstream ss;
+
+        std::string line;
+        std::string prefix;
+        while (std::getline(fin, line))
+        {
+            ss.clear();
+            ss.str(line);
+            ss >> prefix;
+
+            if (prefix == "newmtl")
+            {
+                materials.push_back(Material());
+                pos++;
+            }
+            else if (prefix == "Ka")
+            {
+                glm::vec3 ambient;
+                ss >> ambient.x >> ambient.y >> ambient.z;
+                materials[pos].ambient = ambient;
+            }
+            else if (prefix == "Kd")
+            {
+                glm::vec3 diffuse;
+                ss >> diffuse.x >> diffuse.y >> diffuse.z;
+                materials[pos].diffuse = diffuse;
+            }
+            else if (prefix == "Ks")
+            {
+                glm::vec3 specular;
+                ss >> specular.x >> specular.y >> specular.z;
+                materials[pos].specular = specular;
+            }
+        }
+        return materials;
+    }
+
+    // Repeats parse until at least minimumMs have passed; returns MB/s.
+    template <typename Parse>
+    double measureThroughput(size_t bytes, Parse parse)
+    {
+        const double minimumMs = 250.0;
+        size_t runs = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            parse();
+            runs++;
+        } while (elapsedMs(start) < minimumMs);
+        return (double(bytes) * runs / (1024.0 * 1024.0)) / (elapsedMs(start) / 1000.0);
+    }
+
+    // The particle loop ParticleSystem replaced, kept as the baseline: an
+    // array of structs walked in full, with rand() reseeding the dead in place.
+    struct LegacyParticle
+    {
+        glm::vec3 position;
+        glm::vec3 velocity;
+        float lifetime;
+        bool active;
+    };
+
+    void legacyUpdateParticles(std::vector<LegacyParticle>& particles, float deltaTime)
+    {
+        for (auto& p : particles)
+        {
+            if (!p.active) continue;
+
+            p.position += p.velocity * deltaTime;
+            p.lifetime -= deltaTime;
+
+            if (p.lifetime <= 0)
+            {
+                p.position.y = 10;
+                p.lifetime = float(rand() % 10 + 5);
+            }
+        }
+    }
+
+    void emitBenchmarkParticles(ParticleSystem& system)
+    {
+        system.Emit(system.Capacity() - system.Count(), [](ParticleInit& p, FastRandom& random)
+        {
+            p.position = glm::vec3(random.Range(-50.0f, 50.0f), random.Range(0.0f, 20.0f), random.Range(-50.0f, 50.0f));
+            p.velocity = glm::vec3(random.Range(-1.0f, 1.0f), random.Range(-5.0f, 5.0f), random.Range(-1.0f, 1.0f));
+            p.lifetime = random.Range(0.5f, 5.0f);
+        });
+    }
+
+    // Repeats one simulation step until at least minimumMs have passed; returns particle updates per second.
+    template <typename Step>
+    double measureUpdates(size_t particles, Step step)
+    {
+        const double minimumMs = 500.0;
+        size_t runs = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            step();
+            runs++;
+        } while (elapsedMs(start) < minimumMs);
+        return double(particles) * runs / (elapsedMs(start) / 1000.0);
+    }
+}
+
+void RunLoadBenchmark(const std::vector<std::string>& modelPaths)
+{
+    double totalAssimp = 0.0, totalCold = 0.0, totalWarm = 0.0;
+
+    std::cout << "LOAD BENCHMARK (ms)" << std::endl;
+    std::cout << std::setw(12) << "assimp" << std::setw(12) << "cold cache" << std::setw(12) << "warm cache" << "  model" << std::endl;
+    for (const std::string& path : modelPaths)
+    {
+        std::remove(MeshCache::CachePath(path).c_str());
+
+        double assimp = timeModelLoad(path, false, false);
+        double cold = timeModelLoad(path, true, true);
+        double warm = timeModelLoad(path, true, true);
+        totalAssimp += assimp;
+        totalCold += cold;
+        totalWarm += warm;
+
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(12) << assimp << std::setw(12) << cold << std::setw(12) << warm
+            << "  " << path.substr(path.find_last_of("\\/") + 1) << std::endl;
+    }
+    std::cout << std::setw(12) << totalAssimp << std::setw(12) << totalCold << std::setw(12) << totalWarm << "  total" << std::endl;
+}
+
+
+void RunMtlBenchmark(const std::vector<std::string>& mtlPaths)
+{
+    std::cout << "MTL BENCHMARK (MB/s)" << std::endl;
+    std::cout << std::setw(12) << "stringstream" << std::setw(12) << "mapped" << std::setw(10) << "speedup" << std::setw(10) << "KB"
+        << std::setw(11) << "materials" << "  file" << std::endl;
+    for (const std::string& path : mtlPaths)
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (text.empty())
+            continue;
+
+        double legacy = measureThroughput(text.size(), [&text]()
+        {
+            std::istringstream fin(text);
+            legacyLoadMTL(fin);
+        });
+
+        size_t materialCount = 0;
+        double mapped = measureThroughput(text.size(), [&text, &materialCount]()
+        {
+            MaterialLibrary library;
+            library.Parse(text.data(), text.size());
+            materialCount = library.Materials().size();
+        });
+
+        std::cout << std::fixed << std::setprecision(1)
+            << std::setw(12) << legacy << std::setw(12) << mapped << std::setw(9) << mapped / legacy << "x"
+            << std::setw(10) << text.size() / 1024.0 << std::setw(11) << materialCount
+            << "  " << path.substr(path.find_last_of("\\/") + 1) << std::endl;
+    }
+}
+
+void RunObjBenchmark(const std::vector<std::string>& objPaths)
+{
+    std::cout << "OBJ BENCHMARK (ms, " << ThreadPool::Shared().ThreadCount() + 1 << " threads)" << std::endl;
+    std::cout << std::setw(12) << "assimp" << std::setw(12) << "native" << std::setw(10) << "speedup" << std::setw(10) << "MB"
+        << std::setw(12) << "triangles" << "  model" << std::endl;
+    for (const std::string& path : objPaths)
+    {
+        size_t assimpTriangles = 0, nativeTriangles = 0;
+        double assimp = timeModelImport(path, false, assimpTriangles);
+        double native = timeModelImport(path, true, nativeTriangles);
+
+        MappedFile file(path);
+        std::cout << std::fixed << std::setprecision(2)
+            << std::setw(12) << assimp << std::setw(12) << native << std::setw(9) << assimp / native << "x"
+            << std::setw(10) << file.Size() / (1024.0 * 1024.0) << std::setw(12) << nativeTriangles
+            << "  " << path.substr(path.find_last_of("\\/") + 1);
+        if (assimpTriangles != nativeTriangles)
+            std::cout << " (assimp: " << assimpTriangles << " triangles)";
+        std::cout << std::endl;
+    }
+}
+
+void RunParticleBenchmark(size_t particleCount)
+{
+    const float deltaTime = 1.0f / 60.0f;
+    size_t threads = ThreadPool::Shared().ThreadCount() + 1;
+
+    std::vector<LegacyParticle> legacy(particleCount);
+    for (LegacyParticle& p : legacy)
+    {
+        p.position = glm::vec3(rand() % 100 - 50, rand() % 10 + 10, rand() % 100 - 50);
+        p.velocity = glm::vec3(0, -0.1, 0);
+        p.lifetime = float(rand() % 10 + 5);
+        p.active = true;
+    }
+    double legacyRate = measureUpdates(particleCount, [&]() { legacyUpdateParticles(legacy, deltaTime); });
+
+    // Short lifetimes and ground bounces so removal, refilling and the collision masks are all exercised.
+    ParticleSystem system(particleCount);
+    system.SetGravity(glm::vec3(0.0f, -9.81f, 0.0f));
+    GroundCollision ground;
+    ground.enabled = true;
+    system.SetGroundCollision(ground);
+
+    auto step = [&](bool parallel)
+    {
+        system.Update(deltaTime, parallel);
+        emitBenchmarkParticles(system);
+    };
+    emitBenchmarkParticles(system);
+    double serialRate = measureUpdates(particleCount, [&]() { step(false); });
+    double parallelRate = measureUpdates(particleCount, [&]() { step(true); });
+
+    std::cout << "PARTICLE BENCHMARK (" << particleCount << " particles, " << threads << " threads, M updates/s)" << std::endl;
+    std::cout << std::setw(12) << "legacy" << std::setw(12) << "soa" << std::setw(12) << "parallel"
+        << std::setw(12) << "per core" << std::setw(10) << "speedup" << std::endl;
+    std::cout << std::fixed << std::setprecision(2)
+        << std::setw(12) << legacyRate / 1e6 << std::setw(12) << serialRate / 1e6 << std::setw(12) << parallelRate / 1e6
+        << std::setw(12) << parallelRate / threads / 1e6 << std::setw(9) << parallelRate / legacyRate << "x" << std::endl;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Command line benchmarks, run from main() after the GL context exists.
+
+// Times every model with Assimp only (no ObjImporter, no mesh cache), then with
+// the default options from a cold and a warm mesh cache.
+void RunLoadBenchmark(const std::vector<std::string>& modelPaths);
+
+// Parses every .mtl file repeatedly from memory with the old stringstream
+// loader and with MaterialLibrary, and prints the throughput of both in MB/s.
+void RunMtlBenchmark(const std::vector<std::string>& mtlPaths);
+
+// Imports every .obj file with Assimp and with ObjImporter (no mesh cache, no
+// GL work) and prints the better of three runs of each.
+void RunObjBenchmark(const std::vector<std::string>& objPaths);
+
+// Steps particleCount particles at 60 Hz with the old array-of-structs loop,
+// then with ParticleSystem on one thread and on the whole ThreadPool (gravity,
+// ground bounces and refilling included), and prints updates per second.
+void RunParticleBenchmark(size_t particleCount);
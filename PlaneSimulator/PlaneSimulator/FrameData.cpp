@@ -0,0 +1,33 @@
+#include "FrameData.h"
+
+#include "GLState.h"
+
+FrameUniformBuffer& FrameUniformBuffer::Get()
+{
+    static FrameUniformBuffer instance;
+    return instance;
+}
+
+void FrameUniformBuffer::Update(const FrameUniforms& frame)
+{
+    current = frame;
+    if (!buffer)
+    {
+        glGenBuffers(1, &buffer);
+        GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), nullptr, GL_DYNAMIC_DRAW);
+        GLState::Get().BindBufferBase(GL_UNIFORM_BUFFER, FrameDataBinding, buffer);
+    }
+    else
+        GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, buffer);
+
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &current);
+    GLState::Get().BindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void FrameUniformBuffer::Shutdown()
+{
+    if (buffer)
+        GLState::Get().DeleteBuffers(1, &buffer);
+    buffer = 0;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm.hpp>
+
+// Uniform buffer binding point of the FrameData block; Shader points every
+// program that declares the block at it when it links.
+const GLuint FrameDataBinding = 0;
+
+// Everything that is the same for every draw in a frame, laid out as the
+// std140 FrameData block the shaders declare. vec3s are padded to vec4 so the
+// C++ and GLSL offsets agree without explicit padding members.
+struct FrameUniforms
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    // xyz world position, w unused.
+    glm::vec4 cameraPosition = glm::vec4(0.0f);
+    glm::vec4 lightPosition = glm::vec4(0.0f);
+    // rgb light colour times intensity.
+    glm::vec4 lightColor = glm::vec4(1.0f);
+    glm::vec4 skyColor = glm::vec4(0.0f);
+    // x hour of day (0-24), y seconds since start.
+    glm::vec4 timeOfDay = glm::vec4(0.0f);
+};
+
+static_assert(sizeof(FrameUniforms) == 3 * 64 + 5 * 16, "FrameUniforms must match the std140 FrameData block");
+
+// The per-frame uniform buffer. Filled once after the camera moves and left
+// bound to FrameDataBinding, so draws only upload their own model matrix.
+// GL thread only.
+class FrameUniformBuffer
+{
+public:
+    static FrameUniformBuffer& Get();
+
+    // Uploads the frame's values, creating the buffer on first use.
+    void Update(const FrameUniforms& frame);
+    // Values of the last Update, for CPU side work such as LOD selection and culling.
+    const FrameUniforms& Current() const { return current; }
+    // Deletes the buffer; call before the context goes away.
+    void Shutdown();
+
+private:
+    FrameUniformBuffer() = default;
+
+    FrameUniforms current;
+    GLuint buffer = 0;
+};
@@ -0,0 +1,35 @@
+#include "Frustum.h"
+
+Frustum Frustum::FromMatrix(const glm::mat4& viewProjection)
+{
+    // Gribb and Hartmann: each plane is the fourth row of the matrix plus or minus another row.
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+    Frustum frustum;
+    frustum.planes[Left] = rows[3] + rows[0];
+    frustum.planes[Right] = rows[3] - rows[0];
+    frustum.planes[Bottom] = rows[3] + rows[1];
+    frustum.planes[Top] = rows[3] - rows[1];
+    frustum.planes[Near] = rows[3] + rows[2];
+    frustum.planes[Far] = rows[3] - rows[2];
+
+    for (glm::vec4& plane : frustum.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+    return frustum;
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (const glm::vec4& plane : planes)
+    {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <GLM.hpp>
+
+// The six clip planes of a view-projection matrix, normals pointing inward.
+// Built from a full model-view-projection matrix the planes are in that
+// model's space, so model-space bounds can be tested without transforming them.
+struct Frustum
+{
+    enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    // xyz is the unit normal, w the offset: a point p is inside when dot(xyz, p) + w >= 0.
+    glm::vec4 planes[PlaneCount];
+
+    static Frustum FromMatrix(const glm::mat4& viewProjection);
+
+    // False only if the sphere lies entirely outside one of the planes.
+    bool IntersectsSphere(const glm::vec3& center, float radius) const;
+};
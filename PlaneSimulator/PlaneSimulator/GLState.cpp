@@ -0,0 +1,248 @@
+#include "GLState.h"
+
+#include "RenderStats.h"
+
+namespace
+{
+    // Slots of the cached targets, or -1 for targets that always go to the driver.
+    int bufferSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_ARRAY_BUFFER: return 0;
+        case GL_ELEMENT_ARRAY_BUFFER: return 1;
+        case GL_UNIFORM_BUFFER: return 2;
+        case GL_PIXEL_UNPACK_BUFFER: return 3;
+        case GL_COPY_READ_BUFFER: return 4;
+        case GL_COPY_WRITE_BUFFER: return 5;
+        default: return -1;
+        }
+    }
+
+    int textureSlot(GLenum target)
+    {
+        switch (target)
+        {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_CUBE_MAP: return 1;
+        case GL_TEXTURE_2D_ARRAY: return 2;
+        default: return -1;
+        }
+    }
+
+    int capabilitySlot(GLenum capability)
+    {
+        switch (capability)
+        {
+        case GL_BLEND: return 0;
+        case GL_DEPTH_TEST: return 1;
+        case GL_CULL_FACE: return 2;
+        default: return -1;
+        }
+    }
+
+    const int ElementBufferSlot = 1;
+}
+
+GLState& GLState::Get()
+{
+    static GLState instance;
+    return instance;
+}
+
+bool GLState::skip(bool redundant)
+{
+    RenderStats::Get().AddStateCall(redundant);
+    return redundant;
+}
+
+void GLState::UseProgram(GLuint id)
+{
+    if (skip(program == id))
+        return;
+    program = id;
+    glUseProgram(id);
+}
+
+void GLState::BindVertexArray(GLuint id)
+{
+    if (skip(vertexArray == id))
+        return;
+    vertexArray = id;
+    buffers[ElementBufferSlot] = Unknown;
+    glBindVertexArray(id);
+}
+
+void GLState::BindBuffer(GLenum target, GLuint buffer)
+{
+    int slot = bufferSlot(target);
+    if (slot >= 0)
+    {
+        if (skip(buffers[slot] == buffer))
+            return;
+        buffers[slot] = buffer;
+    }
+    glBindBuffer(target, buffer);
+}
+
+void GLState::BindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    int slot = bufferSlot(target);
+    if (slot >= 0)
+        buffers[slot] = buffer;
+    glBindBufferBase(target, index, buffer);
+}
+
+void GLState::ActiveTexture(GLuint unit)
+{
+    if (skip(activeUnit == unit))
+        return;
+    activeUnit = unit;
+    glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLState::BindTexture(GLenum target, GLuint texture)
+{
+    int slot = textureSlot(target);
+    if (slot >= 0 && activeUnit < GLuint(MaxTextureUnits))
+    {
+        if (skip(textures[activeUnit][slot] == texture))
+            return;
+        textures[activeUnit][slot] = texture;
+    }
+    glBindTexture(target, texture);
+}
+
+void GLState::BindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    // Check before switching units, so an already bound texture costs no glActiveTexture either.
+    int slot = textureSlot(target);
+    if (slot >= 0 && unit < GLuint(MaxTextureUnits) && skip(textures[unit][slot] == texture))
+        return;
+    ActiveTexture(unit);
+    if (slot >= 0 && unit < GLuint(MaxTextureUnits))
+        textures[unit][slot] = texture;
+    glBindTexture(target, texture);
+}
+
+void GLState::Enable(GLenum capability)
+{
+    SetEnabled(capability, true);
+}
+
+void GLState::Disable(GLenum capability)
+{
+    SetEnabled(capability, false);
+}
+
+void GLState::SetEnabled(GLenum capability, bool enabled)
+{
+    int slot = capabilitySlot(capability);
+    if (slot >= 0)
+    {
+        if (skip(capabilities[slot] == int8_t(enabled)))
+            return;
+        capabilities[slot] = int8_t(enabled);
+    }
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+bool GLState::IsEnabled(GLenum capability)
+{
+    int slot = capabilitySlot(capability);
+    if (slot < 0)
+        return glIsEnabled(capability) == GL_TRUE;
+    if (capabilities[slot] < 0)
+        capabilities[slot] = int8_t(glIsEnabled(capability) == GL_TRUE);
+    return capabilities[slot] == 1;
+}
+
+void GLState::BlendFunc(GLenum source, GLenum destination)
+{
+    if (skip(blendSource == source && blendDestination == destination))
+        return;
+    blendSource = source;
+    blendDestination = destination;
+    glBlendFunc(source, destination);
+}
+
+void GLState::DepthFunc(GLenum function)
+{
+    if (skip(depthFunction == function))
+        return;
+    depthFunction = function;
+    glDepthFunc(function);
+}
+
+void GLState::DepthMask(bool write)
+{
+    if (skip(depthWrite == int8_t(write)))
+        return;
+    depthWrite = int8_t(write);
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void GLState::DeleteBuffers(GLsizei count, const GLuint* ids)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (GLuint& bound : buffers)
+        {
+            if (bound == ids[i])
+                bound = 0;
+        }
+    }
+    glDeleteBuffers(count, ids);
+}
+
+void GLState::DeleteTextures(GLsizei count, const GLuint* ids)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (auto& unit : textures)
+        {
+            for (GLuint& bound : unit)
+            {
+                if (bound == ids[i])
+                    bound = 0;
+            }
+        }
+    }
+    glDeleteTextures(count, ids);
+}
+
+void GLState::DeleteVertexArrays(GLsizei count, const GLuint* ids)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (vertexArray == ids[i])
+        {
+            vertexArray = 0;
+            buffers[ElementBufferSlot] = Unknown;
+        }
+    }
+    glDeleteVertexArrays(count, ids);
+}
+
+void GLState::Invalidate()
+{
+    program = Unknown;
+    vertexArray = Unknown;
+    for (GLuint& bound : buffers)
+        bound = Unknown;
+    activeUnit = Unknown;
+    for (auto& unit : textures)
+    {
+        for (GLuint& bound : unit)
+            bound = Unknown;
+    }
+    for (int8_t& capability : capabilities)
+        capability = -1;
+    blendSource = Unknown;
+    blendDestination = Unknown;
+    depthFunction = Unknown;
+    depthWrite = -1;
+}
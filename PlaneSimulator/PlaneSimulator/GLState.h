@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+
+// Shadow copy of the GL state the renderer touches: bound program, VAO,
+// buffers, textures per unit and the blend/depth/cull switches. Calls that
+// would not change anything never reach the driver, so draw code can state
+// what it needs without first unbinding what the previous draw left behind.
+// Everything that binds, enables or deletes these objects has to go through
+// here, or the shadow goes stale; code that cannot (third-party libraries)
+// calls Invalidate afterwards. GL thread only.
+class GLState
+{
+public:
+    static GLState& Get();
+
+    void UseProgram(GLuint program);
+    GLuint Program() const { return program; }
+
+    // Also forgets the element buffer, which belongs to the VAO.
+    void BindVertexArray(GLuint vertexArray);
+    void BindBuffer(GLenum target, GLuint buffer);
+    // glBindBufferBase also moves the generic binding, which the cache follows.
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+
+    // Units are indices, not GL_TEXTUREi enums.
+    void ActiveTexture(GLuint unit);
+    // Binds to the active unit.
+    void BindTexture(GLenum target, GLuint texture);
+    void BindTexture(GLuint unit, GLenum target, GLuint texture);
+
+    void Enable(GLenum capability);
+    void Disable(GLenum capability);
+    void SetEnabled(GLenum capability, bool enabled);
+    // Answered from the cache for tracked capabilities, without a driver round trip.
+    bool IsEnabled(GLenum capability);
+    void BlendFunc(GLenum source, GLenum destination);
+    void DepthFunc(GLenum function);
+    void DepthMask(bool write);
+
+    // Deleting a bound object unbinds it, so these drop it from the cache too.
+    void DeleteBuffers(GLsizei count, const GLuint* buffers);
+    void DeleteTextures(GLsizei count, const GLuint* textures);
+    void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+
+    // Forgets everything; the next call of each kind goes to the driver.
+    void Invalidate();
+
+private:
+    GLState() = default;
+
+    static const GLuint Unknown = 0xFFFFFFFFu;
+    static const int MaxTextureUnits = 16;
+    static const int TextureTargetCount = 3;
+    static const int BufferTargetCount = 6;
+    static const int CapabilityCount = 3;
+
+    // Reports whether the call is redundant, counting it either way.
+    bool skip(bool redundant);
+
+    GLuint program = 0;
+    GLuint vertexArray = 0;
+    GLuint buffers[BufferTargetCount] = {};
+    GLuint activeUnit = 0;
+    GLuint textures[MaxTextureUnits][TextureTargetCount] = {};
+    // -1 unknown, 0 disabled, 1 enabled.
+    // The context starts with everything unbound and disabled, as the initialisers say.
+    int8_t capabilities[CapabilityCount] = {};
+    GLenum blendSource = GL_ONE;
+    GLenum blendDestination = GL_ZERO;
+    GLenum depthFunction = GL_LESS;
+    int8_t depthWrite = 1;
+};
@@ -0,0 +1,360 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "GLState.h"
+#include "InstanceBuffer.h"
+#include "VertexPacking.h"
+
+namespace
+{
+    const char* const FormatNames[VertexFormatCount] = { "full", "packed" };
+
+    size_t vertexStride(VertexFormat format)
+    {
+        return format == VertexFormatPacked ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+
+    size_t indexSize(GLenum indexType)
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    }
+
+    void printBufferStats(const char* name, const char* unit, const ArenaBufferStats& stats)
+    {
+        std::cout << "  " << std::left << std::setw(16) << name << std::right
+            << std::setw(10) << stats.used << " / " << std::setw(10) << stats.capacity << " " << std::setw(8) << unit
+            << std::fixed << std::setprecision(1) << std::setw(7) << stats.Occupancy() * 100.0f << "% used"
+            << std::setw(6) << stats.freeBlocks << " free blocks"
+            << std::setw(7) << stats.Fragmentation() * 100.0f << "% fragmented" << std::endl;
+    }
+}
+
+FreeListAllocator::FreeListAllocator(size_t capacity)
+    : capacity(capacity)
+{
+    if (capacity > 0)
+        freeBlocks[0] = capacity;
+}
+
+bool FreeListAllocator::Allocate(size_t size, size_t alignment, size_t& offset)
+{
+    auto best = freeBlocks.end();
+    size_t bestStart = 0;
+    for (auto block = freeBlocks.begin(); block != freeBlocks.end(); ++block)
+    {
+        size_t start = (block->first + alignment - 1) / alignment * alignment;
+        size_t end = block->first + block->second;
+        if (start + size > end)
+            continue;
+        if (best == freeBlocks.end() || block->second < best->second)
+        {
+            best = block;
+            bestStart = start;
+        }
+    }
+    if (best == freeBlocks.end())
+        return false;
+
+    // Split off the alignment padding in front and the remainder behind.
+    size_t blockOffset = best->first;
+    size_t blockEnd = best->first + best->second;
+    freeBlocks.erase(best);
+    if (bestStart > blockOffset)
+        freeBlocks[blockOffset] = bestStart - blockOffset;
+    if (bestStart + size < blockEnd)
+        freeBlocks[bestStart + size] = blockEnd - (bestStart + size);
+
+    used += size;
+    offset = bestStart;
+    return true;
+}
+
+void FreeListAllocator::Free(size_t offset, size_t size)
+{
+    if (size == 0)
+        return;
+    used -= size;
+
+    auto next = freeBlocks.lower_bound(offset);
+    if (next != freeBlocks.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            freeBlocks.erase(previous);
+        }
+    }
+    if (next != freeBlocks.end() && offset + size == next->first)
+    {
+        size += next->second;
+        freeBlocks.erase(next);
+    }
+    freeBlocks[offset] = size;
+}
+
+void FreeListAllocator::Grow(size_t newCapacity)
+{
+    if (newCapacity <= capacity)
+        return;
+
+    size_t offset = capacity;
+    size_t size = newCapacity - capacity;
+    capacity = newCapacity;
+    // Free() would count the new space as released memory.
+    used += size;
+    Free(offset, size);
+}
+
+size_t FreeListAllocator::LargestFreeBlock() const
+{
+    size_t largest = 0;
+    for (const auto& block : freeBlocks)
+        largest = std::max(largest, block.second);
+    return largest;
+}
+
+GeometryArena& GeometryArena::Get()
+{
+    static GeometryArena instance;
+    return instance;
+}
+
+void GeometryArena::createPool(VertexFormat format)
+{
+    Pool& pool = pools[format];
+    pool.vertices = FreeListAllocator(InitialVertexCapacity);
+    pool.indices = FreeListAllocator(InitialIndexBytes);
+
+    glGenVertexArrays(1, &pool.VAO);
+    glGenBuffers(1, &pool.VBO);
+    glGenBuffers(1, &pool.EBO);
+
+    GLState::Get().BindVertexArray(pool.VAO);
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    glBufferData(GL_ARRAY_BUFFER, InitialVertexCapacity * vertexStride(format), NULL, GL_STATIC_DRAW);
+    GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, InitialIndexBytes, NULL, GL_STATIC_DRAW);
+    setupAttributes(format);
+    GLState::Get().BindVertexArray(0);
+}
+
+void GeometryArena::setupAttributes(VertexFormat format)
+{
+    // Expects the pool's VAO and vertex buffer to be bound.
+    if (format == VertexFormatPacked)
+    {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+    }
+    else
+    {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    }
+}
+
+unsigned int GeometryArena::growBuffer(unsigned int buffer, size_t oldBytes, size_t newBytes)
+{
+    unsigned int grown;
+    glGenBuffers(1, &grown);
+    GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+    GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+    GLState::Get().BindBuffer(GL_COPY_READ_BUFFER, 0);
+    GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    GLState::Get().DeleteBuffers(1, &buffer);
+    return grown;
+}
+
+GeometryRange GeometryArena::Allocate(VertexFormat format, const void* vertices, size_t vertexCount,
+    const void* indices, size_t indexCount, GLenum indexType)
+{
+    GeometryRange range;
+    range.format = format;
+    range.indexType = indexType;
+    if (vertexCount == 0 || indexCount == 0)
+        return range;
+
+    Pool& pool = pools[format];
+    if (pool.VAO == 0)
+        createPool(format);
+
+    const size_t stride = vertexStride(format);
+    const size_t indexBytes = indexCount * indexSize(indexType);
+
+    size_t baseVertex;
+    while (!pool.vertices.Allocate(vertexCount, 1, baseVertex))
+    {
+        size_t oldCapacity = pool.vertices.Capacity();
+        size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + vertexCount);
+        pool.VBO = growBuffer(pool.VBO, oldCapacity * stride, newCapacity * stride);
+        pool.vertices.Grow(newCapacity);
+
+        // The VAO captured the old buffer in its attribute pointers.
+        GLState::Get().BindVertexArray(pool.VAO);
+        GLState::Get().BindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+        setupAttributes(format);
+        GLState::Get().BindVertexArray(0);
+        if (pool.instancedVAO)
+            attachGeometry(pool, format);
+    }
+
+    size_t indexOffset;
+    while (!pool.indices.Allocate(indexBytes, indexSize(indexType), indexOffset))
+    {
+        size_t oldCapacity = pool.indices.Capacity();
+        size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + indexBytes + sizeof(unsigned int));
+        pool.EBO = growBuffer(pool.EBO, oldCapacity, newCapacity);
+        pool.indices.Grow(newCapacity);
+
+        GLState::Get().BindVertexArray(pool.VAO);
+        GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+        GLState::Get().BindVertexArray(0);
+        if (pool.instancedVAO)
+            attachGeometry(pool, format);
+    }
+
+    GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, pool.VBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, baseVertex * stride, vertexCount * stride, vertices);
+    GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, pool.EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset, indexBytes, indices);
+    GLState::Get().BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    range.baseVertex = static_cast<unsigned int>(baseVertex);
+    range.vertexCount = static_cast<unsigned int>(vertexCount);
+    range.indexOffset = indexOffset;
+    range.indexCount = static_cast<unsigned int>(indexCount);
+    return range;
+}
+
+void GeometryArena::Free(const GeometryRange& range)
+{
+    Pool& pool = pools[range.format];
+    if (!range.IsValid() || pool.VAO == 0)
+        return;
+
+    pool.vertices.Free(range.baseVertex, range.vertexCount);
+    pool.indices.Free(range.indexOffset, range.indexCount * indexSize(range.indexType));
+}
+
+void GeometryArena::Bind(VertexFormat format)
+{
+    GLState::Get().BindVertexArray(pools[format].VAO);
+}
+
+void GeometryArena::attachGeometry(Pool& pool, VertexFormat format)
+{
+    GLState::Get().BindVertexArray(pool.instancedVAO);
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, pool.VBO);
+    setupAttributes(format);
+    GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO);
+}
+
+void GeometryArena::BindInstanced(VertexFormat format, GLuint instanceBuffer)
+{
+    Pool& pool = pools[format];
+    if (pool.VAO == 0)
+        return;
+
+    if (pool.instancedVAO == 0)
+    {
+        glGenVertexArrays(1, &pool.instancedVAO);
+        attachGeometry(pool, format);
+        for (GLuint row = 0; row < 3; row++)
+        {
+            glEnableVertexAttribArray(InstanceAttributeLocation + row);
+            glVertexAttribDivisor(InstanceAttributeLocation + row, 1);
+        }
+    }
+
+    GLState::Get().BindVertexArray(pool.instancedVAO);
+    if (pool.instanceSource == instanceBuffer)
+        return;
+
+    // Three vec4 rows per instance; the VAO remembers the buffer, so this only runs when the source changes.
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint row = 0; row < 3; row++)
+        glVertexAttribPointer(InstanceAttributeLocation + row, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform),
+            (void*)(row * sizeof(glm::vec4)));
+    pool.instanceSource = instanceBuffer;
+}
+
+void GeometryArena::ForgetInstanceBuffer(GLuint instanceBuffer)
+{
+    for (Pool& pool : pools)
+    {
+        if (pool.instanceSource == instanceBuffer)
+            pool.instanceSource = 0;
+    }
+}
+
+ArenaBufferStats GeometryArena::VertexStats(VertexFormat format) const
+{
+    const FreeListAllocator& allocator = pools[format].vertices;
+    ArenaBufferStats stats;
+    stats.capacity = allocator.Capacity();
+    stats.used = allocator.Used();
+    stats.freeBlocks = allocator.FreeBlockCount();
+    stats.largestFreeBlock = allocator.LargestFreeBlock();
+    return stats;
+}
+
+ArenaBufferStats GeometryArena::IndexStats(VertexFormat format) const
+{
+    const FreeListAllocator& allocator = pools[format].indices;
+    ArenaBufferStats stats;
+    stats.capacity = allocator.Capacity();
+    stats.used = allocator.Used();
+    stats.freeBlocks = allocator.FreeBlockCount();
+    stats.largestFreeBlock = allocator.LargestFreeBlock();
+    return stats;
+}
+
+void GeometryArena::PrintStats() const
+{
+    std::cout << "GEOMETRY ARENA" << std::endl;
+    for (int format = 0; format < VertexFormatCount; format++)
+    {
+        if (pools[format].VAO == 0)
+            continue;
+        std::string name = FormatNames[format];
+        printBufferStats((name + " vertices").c_str(), "verts", VertexStats(VertexFormat(format)));
+        printBufferStats((name + " indices").c_str(), "bytes", IndexStats(VertexFormat(format)));
+    }
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+void GeometryArena::Shutdown()
+{
+    for (Pool& pool : pools)
+    {
+        if (pool.VAO == 0)
+            continue;
+        GLState::Get().DeleteVertexArrays(1, &pool.VAO);
+        if (pool.instancedVAO)
+            GLState::Get().DeleteVertexArrays(1, &pool.instancedVAO);
+        GLState::Get().DeleteBuffers(1, &pool.VBO);
+        GLState::Get().DeleteBuffers(1, &pool.EBO);
+        pool = Pool();
+    }
+}
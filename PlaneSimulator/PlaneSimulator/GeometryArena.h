@@ -0,0 +1,124 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <map>
+
+// Vertex layouts the arena keeps a buffer pair and VAO for.
+enum VertexFormat
+{
+    VertexFormatFull,   // Vertex
+    VertexFormatPacked, // PackedVertex
+    VertexFormatCount
+};
+
+// Where a mesh lives inside the arena; drawn with glDrawElementsBaseVertex.
+struct GeometryRange
+{
+    VertexFormat format = VertexFormatFull;
+    unsigned int baseVertex = 0;
+    unsigned int vertexCount = 0;
+    // Byte offset into the format's index buffer.
+    size_t indexOffset = 0;
+    unsigned int indexCount = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    bool IsValid() const { return indexCount != 0; }
+};
+
+// Best-fit allocator over [0, capacity) that merges adjacent free blocks.
+class FreeListAllocator
+{
+public:
+    explicit FreeListAllocator(size_t capacity = 0);
+
+    // False if no free block can hold size units at the given alignment.
+    bool Allocate(size_t size, size_t alignment, size_t& offset);
+    void Free(size_t offset, size_t size);
+    // Appends free space at the end.
+    void Grow(size_t newCapacity);
+
+    size_t Capacity() const { return capacity; }
+    size_t Used() const { return used; }
+    size_t FreeBlockCount() const { return freeBlocks.size(); }
+    size_t LargestFreeBlock() const;
+
+private:
+    // offset -> size
+    std::map<size_t, size_t> freeBlocks;
+    size_t capacity;
+    size_t used = 0;
+};
+
+struct ArenaBufferStats
+{
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t freeBlocks = 0;
+    size_t largestFreeBlock = 0;
+
+    float Occupancy() const { return capacity ? float(used) / capacity : 0.0f; }
+    // 0 when all free space is one block, approaching 1 as it splinters.
+    float Fragmentation() const
+    {
+        size_t free = capacity - used;
+        return free ? 1.0f - float(largestFreeBlock) / free : 0.0f;
+    }
+};
+
+// Shared GPU geometry: one VAO with a large vertex and index buffer per
+// vertex format, suballocated per mesh. Meshes of the same format draw
+// without rebinding anything; the buffers double in size when they fill up,
+// so ranges already handed out never move. GL thread only.
+class GeometryArena
+{
+public:
+    static GeometryArena& Get();
+
+    // Copies the data into the arena; an empty mesh yields an invalid range.
+    GeometryRange Allocate(VertexFormat format, const void* vertices, size_t vertexCount,
+        const void* indices, size_t indexCount, GLenum indexType);
+    void Free(const GeometryRange& range);
+
+    void Bind(VertexFormat format);
+    // Binds the format's instanced VAO: the same vertex and index buffers plus
+    // per-instance transforms read from instanceBuffer (see InstanceBuffer.h).
+    void BindInstanced(VertexFormat format, GLuint instanceBuffer);
+    // Call before deleting an instance buffer, so a new buffer reusing its name gets attached again.
+    void ForgetInstanceBuffer(GLuint instanceBuffer);
+
+    // Stats in vertices for the vertex buffer and bytes for the index buffer.
+    ArenaBufferStats VertexStats(VertexFormat format) const;
+    ArenaBufferStats IndexStats(VertexFormat format) const;
+    void PrintStats() const;
+
+    // Deletes every buffer; outstanding ranges become invalid.
+    void Shutdown();
+
+private:
+    struct Pool
+    {
+        unsigned int VAO = 0;
+        unsigned int VBO = 0;
+        unsigned int EBO = 0;
+        // Created on the first instanced draw; instanceSource is the buffer its instance attributes read.
+        unsigned int instancedVAO = 0;
+        unsigned int instanceSource = 0;
+        FreeListAllocator vertices;
+        FreeListAllocator indices;
+    };
+
+    static const size_t InitialVertexCapacity = 64 * 1024;
+    static const size_t InitialIndexBytes = 256 * 1024;
+
+    GeometryArena() = default;
+
+    void createPool(VertexFormat format);
+    void setupAttributes(VertexFormat format);
+    // Points the instanced VAO's geometry at the pool's current buffers.
+    void attachGeometry(Pool& pool, VertexFormat format);
+    // Moves the contents of buffer into a new store of newBytes bytes.
+    static unsigned int growBuffer(unsigned int buffer, size_t oldBytes, size_t newBytes);
+
+    Pool pools[VertexFormatCount];
+};
@@ -0,0 +1,259 @@
+#include "Heightfield.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    struct WorldTriangle
+    {
+        glm::vec3 positions[3];
+        glm::vec2 texCoords[3];
+        // Rows of samples the triangle can cover.
+        int firstRow;
+        int lastRow;
+    };
+
+    // Rows per parallel work item.
+    const int RowsPerBand = 16;
+}
+
+bool Heightfield::FromMeshes(const std::vector<Mesh>& meshes, const glm::mat4& transform, int resolution)
+{
+    std::vector<WorldTriangle> triangles;
+    glm::vec2 low(FLT_MAX), high(-FLT_MAX);
+    for (const Mesh& mesh : meshes)
+    {
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            WorldTriangle triangle;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                const Vertex& vertex = mesh.vertices[mesh.indices[i + corner]];
+                triangle.positions[corner] = glm::vec3(transform * glm::vec4(vertex.Position, 1.0f));
+                triangle.texCoords[corner] = vertex.TexCoords;
+                glm::vec2 xz(triangle.positions[corner].x, triangle.positions[corner].z);
+                low = glm::min(low, xz);
+                high = glm::max(high, xz);
+            }
+            triangles.push_back(triangle);
+        }
+    }
+    if (triangles.empty())
+    {
+        std::cout << "ERROR::HEIGHTFIELD::No triangles to build from; were the meshes loaded with keepCpuData?" << std::endl;
+        return false;
+    }
+
+    width = depth = resolution + 1;
+    origin = low;
+    spacing = std::max(high.x - low.x, high.y - low.y) / resolution;
+    if (spacing <= 0.0f)
+        spacing = 1.0f;
+    heights.assign(size_t(width) * depth, -FLT_MAX);
+    texCoords.assign(size_t(width) * depth, glm::vec2(0.0f));
+
+    for (WorldTriangle& triangle : triangles)
+    {
+        float zLow = std::min({ triangle.positions[0].z, triangle.positions[1].z, triangle.positions[2].z });
+        float zHigh = std::max({ triangle.positions[0].z, triangle.positions[1].z, triangle.positions[2].z });
+        triangle.firstRow = std::max(0, int(std::ceil((zLow - origin.y) / spacing)));
+        triangle.lastRow = std::min(depth - 1, int(std::floor((zHigh - origin.y) / spacing)));
+    }
+
+    // Bands of rows are independent, so each worker owns the samples it writes.
+    int bands = (depth + RowsPerBand - 1) / RowsPerBand;
+    ThreadPool::Shared().ParallelFor(bands, [&](size_t band)
+    {
+        int bandFirst = int(band) * RowsPerBand;
+        int bandLast = std::min(bandFirst + RowsPerBand, depth) - 1;
+        for (const WorldTriangle& triangle : triangles)
+        {
+            int firstRow = std::max(triangle.firstRow, bandFirst);
+            int lastRow = std::min(triangle.lastRow, bandLast);
+            if (firstRow > lastRow)
+                continue;
+
+            glm::vec2 a(triangle.positions[0].x, triangle.positions[0].z);
+            glm::vec2 b(triangle.positions[1].x, triangle.positions[1].z);
+            glm::vec2 c(triangle.positions[2].x, triangle.positions[2].z);
+            float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+            // Vertical walls have no top surface.
+            if (std::abs(area) < 1e-12f)
+                continue;
+
+            float xLow = std::min({ a.x, b.x, c.x });
+            float xHigh = std::max({ a.x, b.x, c.x });
+            int firstColumn = std::max(0, int(std::ceil((xLow - origin.x) / spacing)));
+            int lastColumn = std::min(width - 1, int(std::floor((xHigh - origin.x) / spacing)));
+
+            for (int z = firstRow; z <= lastRow; z++)
+            {
+                for (int x = firstColumn; x <= lastColumn; x++)
+                {
+                    glm::vec2 p = origin + glm::vec2(x, z) * spacing;
+                    float wa = ((b.x - p.x) * (c.y - p.y) - (c.x - p.x) * (b.y - p.y)) / area;
+                    float wb = ((c.x - p.x) * (a.y - p.y) - (a.x - p.x) * (c.y - p.y)) / area;
+                    float wc = 1.0f - wa - wb;
+                    // A small tolerance so samples on shared edges are not lost to rounding.
+                    const float epsilon = -1e-4f;
+                    if (wa < epsilon || wb < epsilon || wc < epsilon)
+                        continue;
+
+                    float height = wa * triangle.positions[0].y + wb * triangle.positions[1].y + wc * triangle.positions[2].y;
+                    size_t index = size_t(z) * width + x;
+                    if (height > heights[index])
+                    {
+                        heights[index] = height;
+                        texCoords[index] = wa * triangle.texCoords[0] + wb * triangle.texCoords[1] + wc * triangle.texCoords[2];
+                    }
+                }
+            }
+        }
+    });
+
+    float lowest = FLT_MAX;
+    for (float height : heights)
+        if (height != -FLT_MAX)
+            lowest = std::min(lowest, height);
+    for (float& height : heights)
+        if (height == -FLT_MAX)
+            height = lowest;
+
+    finishBuild();
+    return true;
+}
+
+bool Heightfield::FromImage(const std::string& path, const glm::vec3& imageOrigin, float sampleSpacing, float heightScale)
+{
+    ImageData image;
+    if (!image.Load(path))
+    {
+        std::cout << "ERROR::HEIGHTFIELD::Failed to load " << path << std::endl;
+        return false;
+    }
+    if (image.width < 2 || image.height < 2)
+    {
+        std::cout << "ERROR::HEIGHTFIELD::" << path << " is smaller than 2x2" << std::endl;
+        return false;
+    }
+
+    width = image.width;
+    depth = image.height;
+    origin = glm::vec2(imageOrigin.x, imageOrigin.z);
+    spacing = sampleSpacing;
+    heights.resize(size_t(width) * depth);
+    texCoords.clear();
+    for (size_t i = 0; i < heights.size(); i++)
+        heights[i] = imageOrigin.y + image.pixels[i * image.channels] / 255.0f * heightScale;
+
+    finishBuild();
+    return true;
+}
+
+float Heightfield::Height(int x, int z) const
+{
+    x = std::min(std::max(x, 0), width - 1);
+    z = std::min(std::max(z, 0), depth - 1);
+    return heights[size_t(z) * width + x];
+}
+
+void Heightfield::locate(float x, float z, size_t& index, float& tx, float& tz) const
+{
+    float fx = std::min(std::max((x - origin.x) * inverseSpacing, 0.0f), float(width - 1));
+    float fz = std::min(std::max((z - origin.y) * inverseSpacing, 0.0f), float(depth - 1));
+    // The last row and column belong to the cell before them.
+    int cellX = std::min(int(fx), width - 2);
+    int cellZ = std::min(int(fz), depth - 2);
+    index = size_t(cellZ) * width + cellX;
+    tx = fx - cellX;
+    tz = fz - cellZ;
+}
+
+float Heightfield::HeightAt(float x, float z) const
+{
+    // A failed build leaves a flat ground at zero rather than a crash.
+    if (heights.empty())
+        return 0.0f;
+
+    size_t index;
+    float tx, tz;
+    locate(x, z, index, tx, tz);
+    const float* row = &heights[index];
+    const float* nextRow = row + width;
+    float front = row[0] + (row[1] - row[0]) * tx;
+    float back = nextRow[0] + (nextRow[1] - nextRow[0]) * tx;
+    return front + (back - front) * tz;
+}
+
+glm::vec3 Heightfield::NormalAt(float x, float z) const
+{
+    if (heights.empty())
+        return glm::vec3(0.0f, 1.0f, 0.0f);
+
+    size_t index;
+    float tx, tz;
+    locate(x, z, index, tx, tz);
+    const float* row = &heights[index];
+    const float* nextRow = row + width;
+    float slopeX = (row[1] - row[0] + ((nextRow[1] - nextRow[0]) - (row[1] - row[0])) * tz) * inverseSpacing;
+    float slopeZ = (nextRow[0] - row[0] + ((nextRow[1] - row[1]) - (nextRow[0] - row[0])) * tx) * inverseSpacing;
+    return glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ));
+}
+
+__m128 Heightfield::HeightsAt(__m128 x, __m128 z) const
+{
+    const __m128 zero = _mm_setzero_ps();
+    if (heights.empty())
+        return zero;
+
+    __m128 fx = _mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(origin.x)), _mm_set1_ps(inverseSpacing));
+    __m128 fz = _mm_mul_ps(_mm_sub_ps(z, _mm_set1_ps(origin.y)), _mm_set1_ps(inverseSpacing));
+    fx = _mm_min_ps(_mm_max_ps(fx, zero), _mm_set1_ps(float(width - 1)));
+    fz = _mm_min_ps(_mm_max_ps(fz, zero), _mm_set1_ps(float(depth - 1)));
+
+    // The values are clamped non-negative, so truncation is floor. Cell and index
+    // math stays in float; a million samples are still exact there.
+    __m128 cellX = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(fx)), _mm_set1_ps(float(width - 2)));
+    __m128 cellZ = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(fz)), _mm_set1_ps(float(depth - 2)));
+    __m128 tx = _mm_sub_ps(fx, cellX);
+    __m128 tz = _mm_sub_ps(fz, cellZ);
+
+    alignas(16) int32_t indices[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices),
+        _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(cellZ, _mm_set1_ps(float(width))), cellX)));
+
+    // SSE2 has no gather; the four corners of each lane are loaded one by one.
+    const float* h = heights.data();
+    __m128 h00 = _mm_setr_ps(h[indices[0]], h[indices[1]], h[indices[2]], h[indices[3]]);
+    __m128 h10 = _mm_setr_ps(h[indices[0] + 1], h[indices[1] + 1], h[indices[2] + 1], h[indices[3] + 1]);
+    h += width;
+    __m128 h01 = _mm_setr_ps(h[indices[0]], h[indices[1]], h[indices[2]], h[indices[3]]);
+    __m128 h11 = _mm_setr_ps(h[indices[0] + 1], h[indices[1] + 1], h[indices[2] + 1], h[indices[3] + 1]);
+
+    __m128 front = _mm_add_ps(h00, _mm_mul_ps(_mm_sub_ps(h10, h00), tx));
+    __m128 back = _mm_add_ps(h01, _mm_mul_ps(_mm_sub_ps(h11, h01), tx));
+    return _mm_add_ps(front, _mm_mul_ps(_mm_sub_ps(back, front), tz));
+}
+
+void Heightfield::HeightsAt(const float* x, const float* z, float* out, size_t count) const
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(out + i, HeightsAt(_mm_loadu_ps(x + i), _mm_loadu_ps(z + i)));
+    for (; i < count; i++)
+        out[i] = HeightAt(x[i], z[i]);
+}
+
+void Heightfield::finishBuild()
+{
+    auto range = std::minmax_element(heights.begin(), heights.end());
+    minHeight = *range.first;
+    maxHeight = *range.second;
+    inverseSpacing = 1.0f / spacing;
+}
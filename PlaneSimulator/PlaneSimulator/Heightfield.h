@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <emmintrin.h>
+#include <glm.hpp>
+
+#include "Mesh.h"
+
+// Terrain heights on a regular grid over the xz plane, in world units.
+// Sample (x, z) lies at Origin() + (x, z) * Spacing(); rows run along z.
+// Queries interpolate bilinearly between the four samples around a point,
+// so they cost the same however large the terrain is; outside the grid the
+// edge samples extend outward.
+class Heightfield
+{
+public:
+    // Rasterizes the top surface of meshes, moved to the world by transform,
+    // into a square grid of resolution + 1 samples a side (resolution a power
+    // of two) covering their xz bounds. Where triangles overlap the highest
+    // one wins, and its texture coordinates are kept with the height.
+    // Samples no triangle covers get the lowest height. The meshes must
+    // have kept their CPU data (ModelLoadOptions::keepCpuData).
+    bool FromMeshes(const std::vector<Mesh>& meshes, const glm::mat4& transform, int resolution);
+    // Reads the first channel of an 8-bit image (at least 2x2): black is origin.y, white origin.y + heightScale.
+    bool FromImage(const std::string& path, const glm::vec3& origin, float spacing, float heightScale);
+
+    bool IsValid() const { return !heights.empty(); }
+    int Width() const { return width; }
+    int Depth() const { return depth; }
+    float Spacing() const { return spacing; }
+    // World xz of sample (0, 0).
+    const glm::vec2& Origin() const { return origin; }
+    // World xz size covered by the samples.
+    glm::vec2 Extent() const { return glm::vec2(width - 1, depth - 1) * spacing; }
+    float MinHeight() const { return minHeight; }
+    float MaxHeight() const { return maxHeight; }
+
+    // Height of a sample; coordinates outside the grid are clamped to its edge.
+    float Height(int x, int z) const;
+
+    // Surface height at world (x, z).
+    float HeightAt(float x, float z) const;
+    // Unit surface normal at world (x, z), from the slope of the interpolated surface.
+    glm::vec3 NormalAt(float x, float z) const;
+    // Height of position above the surface directly below it, as a radio altimeter reads it.
+    float RadioAltitude(const glm::vec3& position) const { return position.y - HeightAt(position.x, position.z); }
+    // HeightAt for four points at once.
+    __m128 HeightsAt(__m128 x, __m128 z) const;
+    // HeightAt for count points, four at a time.
+    void HeightsAt(const float* x, const float* z, float* out, size_t count) const;
+
+    const std::vector<float>& Heights() const { return heights; }
+    // Texture coordinates per sample from FromMeshes; empty when the texture
+    // is mapped straight over the extent.
+    const std::vector<glm::vec2>& TexCoords() const { return texCoords; }
+
+private:
+    // Refreshes the height range and the cached reciprocal spacing after a build.
+    void finishBuild();
+    // Bilinear weights of world (x, z): the cell's first sample and the position inside the cell.
+    void locate(float x, float z, size_t& index, float& tx, float& tz) const;
+
+    int width = 0;
+    int depth = 0;
+    float spacing = 1.0f;
+    float inverseSpacing = 1.0f;
+    glm::vec2 origin = glm::vec2(0.0f);
+    float minHeight = 0.0f;
+    float maxHeight = 0.0f;
+    std::vector<float> heights;
+    std::vector<glm::vec2> texCoords;
+};
@@ -0,0 +1,100 @@
+#include "InstanceBuffer.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "GeometryArena.h"
+#include "GLState.h"
+
+InstanceTransform InstanceTransform::FromMatrix(const glm::mat4& model)
+{
+    // glm is column-major: row r is element r of every column.
+    InstanceTransform transform;
+    for (int r = 0; r < 3; r++)
+        transform.rows[r] = glm::vec4(model[0][r], model[1][r], model[2][r], model[3][r]);
+    return transform;
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    Release();
+}
+
+InstanceBuffer::InstanceBuffer(InstanceBuffer&& other) noexcept
+    : buffer(other.buffer), count(other.count), capacity(other.capacity), center(other.center), spread(other.spread), maxScale(other.maxScale),
+    staging(std::move(other.staging))
+{
+    other.buffer = 0;
+    other.count = 0;
+    other.capacity = 0;
+}
+
+InstanceBuffer& InstanceBuffer::operator=(InstanceBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        buffer = other.buffer;
+        count = other.count;
+        capacity = other.capacity;
+        center = other.center;
+        spread = other.spread;
+        maxScale = other.maxScale;
+        staging = std::move(other.staging);
+        other.buffer = 0;
+        other.count = 0;
+        other.capacity = 0;
+    }
+    return *this;
+}
+
+void InstanceBuffer::Upload(const std::vector<glm::mat4>& transforms)
+{
+    staging.resize(transforms.size());
+    for (size_t i = 0; i < transforms.size(); i++)
+        staging[i] = InstanceTransform::FromMatrix(transforms[i]);
+    Upload(staging.data(), staging.size());
+}
+
+void InstanceBuffer::Upload(const InstanceTransform* transforms, size_t instanceCount)
+{
+    count = instanceCount;
+    center = glm::vec3(0.0f);
+    spread = maxScale = 0.0f;
+    if (count == 0)
+        return;
+
+    for (size_t i = 0; i < count; i++)
+        center += glm::vec3(transforms[i].rows[0].w, transforms[i].rows[1].w, transforms[i].rows[2].w);
+    center /= float(count);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const glm::vec4* rows = transforms[i].rows;
+        spread = std::max(spread, glm::distance(center, glm::vec3(rows[0].w, rows[1].w, rows[2].w)));
+        // Columns of the matrix are the rows' components.
+        for (int axis = 0; axis < 3; axis++)
+            maxScale = std::max(maxScale, glm::length(glm::vec3(rows[0][axis], rows[1][axis], rows[2][axis])));
+    }
+
+    if (!buffer)
+        glGenBuffers(1, &buffer);
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, buffer);
+    // Grow by doubling; otherwise respecify the same size, which hands the driver a fresh store.
+    if (count > capacity)
+        capacity = std::max(count, capacity * 2);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceTransform), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(InstanceTransform), transforms);
+}
+
+void InstanceBuffer::Release()
+{
+    if (buffer)
+    {
+        GeometryArena::Get().ForgetInstanceBuffer(buffer);
+        GLState::Get().DeleteBuffers(1, &buffer);
+    }
+    buffer = 0;
+    count = 0;
+    capacity = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+#include <glm.hpp>
+
+// First of the three vertex attributes that carry an instance's transform,
+// above everything the model vertex shaders already declare.
+const GLuint InstanceAttributeLocation = 7;
+
+// Affine model matrix stored as its top three rows; the instanced shaders
+// rebuild the matrix from them. 48 bytes instead of 64 per instance.
+struct InstanceTransform
+{
+    glm::vec4 rows[3];
+
+    static InstanceTransform FromMatrix(const glm::mat4& model);
+};
+
+// GPU array of per-instance transforms for Model::DrawInstanced. Refilled
+// whenever the instances move; the store is orphaned on every upload so the
+// draw still reading last frame's copy never stalls the CPU. Owns its buffer,
+// so it can be moved but not copied. GL thread only.
+class InstanceBuffer
+{
+public:
+    InstanceBuffer() = default;
+    ~InstanceBuffer();
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+    InstanceBuffer(InstanceBuffer&& other) noexcept;
+    InstanceBuffer& operator=(InstanceBuffer&& other) noexcept;
+
+    void Upload(const std::vector<glm::mat4>& transforms);
+    void Upload(const InstanceTransform* transforms, size_t count);
+
+    GLuint Buffer() const { return buffer; }
+    size_t Count() const { return count; }
+    // World-space centre of the instance positions, for sorting the batch.
+    const glm::vec3& Center() const { return center; }
+    // Largest distance of an instance position from Center, and the largest axis
+    // scale of any instance; with the model's bounds they give a sphere around the batch.
+    float Spread() const { return spread; }
+    float MaxScale() const { return maxScale; }
+
+    // Deletes the buffer early; the destructor does it otherwise.
+    void Release();
+
+private:
+    GLuint buffer = 0;
+    size_t count = 0;
+    size_t capacity = 0;
+    glm::vec3 center = glm::vec3(0.0f);
+    float spread = 0.0f;
+    float maxScale = 0.0f;
+    // Conversion scratch for Upload(transforms), kept to avoid reallocating every frame.
+    std::vector<InstanceTransform> staging;
+};
@@ -0,0 +1,310 @@
+#include "MTLLoader.h"
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+#include "MappedFile.h"
+
+namespace
+{
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // One line without its terminator or trailing comment, consumed token by token.
+    struct LineReader
+    {
+        const char* p;
+        const char* end;
+
+        void SkipSpace()
+        {
+            while (p < end && isSpace(*p))
+                p++;
+        }
+
+        std::string_view Token()
+        {
+            SkipSpace();
+            const char* start = p;
+            while (p < end && !isSpace(*p))
+                p++;
+            return std::string_view(start, p - start);
+        }
+
+        // Everything left on the line with surrounding whitespace trimmed; file names may contain spaces.
+        std::string_view Rest()
+        {
+            SkipSpace();
+            const char* last = end;
+            while (last > p && isSpace(last[-1]))
+                last--;
+            return std::string_view(p, last - p);
+        }
+
+        bool Float(float& value)
+        {
+            SkipSpace();
+            // from_chars rejects an explicit plus sign.
+            if (p < end && *p == '+')
+                p++;
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec != std::errc())
+                return false;
+            p = result.ptr;
+            return true;
+        }
+
+        bool Int(int& value)
+        {
+            SkipSpace();
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec != std::errc())
+                return false;
+            p = result.ptr;
+            return true;
+        }
+
+        // Reads up to count floats, stopping at the first token that is not a number.
+        int Floats(float* values, int count)
+        {
+            int read = 0;
+            while (read < count && Float(values[read]))
+                read++;
+            return read;
+        }
+
+        bool OnOff(bool& value)
+        {
+            std::string_view token = Token();
+            if (token != "on" && token != "off")
+                return false;
+            value = token == "on";
+            return true;
+        }
+    };
+
+    // Ka/Kd/Ks/Ke/Tf: "r [g b]" or "xyz x [y z]"; spectral curves are not supported and leave the colour alone.
+    void parseColor(LineReader& line, glm::vec3& color)
+    {
+        LineReader probe = line;
+        std::string_view token = probe.Token();
+        if (token == "spectral")
+            return;
+        if (token == "xyz")
+            line = probe;
+
+        float values[3];
+        int read = line.Floats(values, 3);
+        if (read == 0)
+            return;
+        color = read == 3 ? glm::vec3(values[0], values[1], values[2]) : glm::vec3(values[0]);
+    }
+
+    void parseVectorOption(LineReader& line, glm::vec3& value)
+    {
+        float values[3] = { value.x, value.y, value.z };
+        line.Floats(values, 3);
+        value = glm::vec3(values[0], values[1], values[2]);
+    }
+
+    void parseTexture(LineReader& line, MaterialTexture& texture)
+    {
+        texture = MaterialTexture();
+        for (;;)
+        {
+            LineReader probe = line;
+            std::string_view option = probe.Token();
+            if (option.empty() || option[0] != '-')
+                break;
+            line = probe;
+
+            if (option == "-blendu")
+                line.OnOff(texture.blendU);
+            else if (option == "-blendv")
+                line.OnOff(texture.blendV);
+            else if (option == "-clamp")
+                line.OnOff(texture.clamp);
+            else if (option == "-boost")
+                line.Float(texture.boost);
+            else if (option == "-mm")
+            {
+                line.Float(texture.base);
+                line.Float(texture.gain);
+            }
+            else if (option == "-bm")
+                line.Float(texture.bumpMultiplier);
+            else if (option == "-o")
+                parseVectorOption(line, texture.offset);
+            else if (option == "-s")
+                parseVectorOption(line, texture.scale);
+            else if (option == "-t")
+                parseVectorOption(line, texture.turbulence);
+            else if (option == "-texres")
+                line.Int(texture.resolution);
+            else if (option == "-imfchan")
+            {
+                std::string_view channel = line.Token();
+                texture.channel = channel.empty() ? 0 : channel[0];
+            }
+            else if (option == "-type")
+                texture.type = std::string(line.Token());
+            else
+                break;
+        }
+        texture.path = std::string(line.Rest());
+    }
+
+    // Maps a texture statement to its slot, or nullptr for any other key.
+    MaterialTexture* textureSlot(Material& material, std::string_view key)
+    {
+        if (key == "map_Kd") return &material.diffuseMap;
+        if (key == "map_Ka") return &material.ambientMap;
+        if (key == "map_Ks") return &material.specularMap;
+        if (key == "map_Ke") return &material.emissiveMap;
+        if (key == "map_Ns") return &material.shininessMap;
+        if (key == "map_d") return &material.alphaMap;
+        if (key == "map_bump" || key == "map_Bump" || key == "bump") return &material.bumpMap;
+        if (key == "disp") return &material.displacementMap;
+        if (key == "decal") return &material.decalMap;
+        if (key == "refl") return &material.reflectionMap;
+        if (key == "norm") return &material.normalMap;
+        if (key == "map_Pr") return &material.roughnessMap;
+        if (key == "map_Pm") return &material.metallicMap;
+        if (key == "map_Ps") return &material.sheenMap;
+        return nullptr;
+    }
+
+    // Maps a scalar statement to its field, or nullptr for any other key.
+    float* scalarSlot(Material& material, std::string_view key)
+    {
+        if (key == "Ns") return &material.shininess;
+        if (key == "Ni") return &material.opticalDensity;
+        if (key == "sharpness") return &material.sharpness;
+        if (key == "Pr") return &material.roughness;
+        if (key == "Pm") return &material.metallic;
+        if (key == "Ps") return &material.sheen;
+        if (key == "Pc") return &material.clearcoat;
+        if (key == "Pcr") return &material.clearcoatRoughness;
+        if (key == "aniso") return &material.anisotropy;
+        if (key == "anisor") return &material.anisotropyRotation;
+        return nullptr;
+    }
+}
+
+bool MaterialLibrary::Load(const std::string& path)
+{
+    MappedFile file(path);
+    if (!file.IsOpen())
+    {
+        std::cout << "ERROR::MTL::Failed to load " << path << std::endl;
+        return false;
+    }
+
+    Parse(reinterpret_cast<const char*>(file.Data()), file.Size());
+    return true;
+}
+
+void MaterialLibrary::Parse(const char* text, size_t size)
+{
+    const char* p = text;
+    const char* end = text + size;
+    Material* current = nullptr;
+
+    while (p < end)
+    {
+        const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!lineEnd)
+            lineEnd = end;
+        const char* comment = static_cast<const char*>(std::memchr(p, '#', lineEnd - p));
+
+        LineReader line = { p, comment ? comment : lineEnd };
+        p = lineEnd + 1;
+
+        std::string_view key = line.Token();
+        if (key.empty())
+            continue;
+
+        if (key == "newmtl")
+        {
+            std::string_view name = Intern(line.Rest());
+            auto existing = indexByName.find(name);
+            if (existing != indexByName.end())
+            {
+                materials[existing->second] = Material();
+                current = &materials[existing->second];
+            }
+            else
+            {
+                indexByName.emplace(name, materials.size());
+                materials.emplace_back();
+                current = &materials.back();
+            }
+            current->name = name;
+            continue;
+        }
+
+        // Statements before the first newmtl have nothing to apply to.
+        if (!current)
+            continue;
+
+        if (key == "Kd")
+            parseColor(line, current->diffuse);
+        else if (key == "Ka")
+            parseColor(line, current->ambient);
+        else if (key == "Ks")
+            parseColor(line, current->specular);
+        else if (key == "Ke")
+            parseColor(line, current->emissive);
+        else if (key == "Tf")
+            parseColor(line, current->transmissionFilter);
+        else if (key == "illum")
+            line.Int(current->illumination);
+        else if (key == "Tr")
+        {
+            float transparency;
+            if (line.Float(transparency))
+                current->opacity = 1.0f - transparency;
+        }
+        else if (key == "d")
+        {
+            // "d -halo factor" is read as a plain dissolve factor.
+            LineReader probe = line;
+            if (probe.Token() == "-halo")
+                line = probe;
+            line.Float(current->opacity);
+        }
+        else if (float* scalar = scalarSlot(*current, key))
+            line.Float(*scalar);
+        else if (MaterialTexture* texture = textureSlot(*current, key))
+            parseTexture(line, *texture);
+    }
+}
+
+void MaterialLibrary::Clear()
+{
+    materials.clear();
+    indexByName.clear();
+    internedNames.clear();
+    names.clear();
+}
+
+const Material* MaterialLibrary::Find(std::string_view name) const
+{
+    auto it = indexByName.find(name);
+    return it != indexByName.end() ? &materials[it->second] : nullptr;
+}
+
+std::string_view MaterialLibrary::Intern(std::string_view name)
+{
+    auto it = internedNames.find(name);
+    if (it != internedNames.end())
+        return *it;
+
+    names.emplace_back(name);
+    std::string_view interned = names.back();
+    internedNames.insert(interned);
+    return interned;
+}
@@ -1,64 +1,44 @@
 #pragma once
-#include "TextureLoader.h"
-#include "Material.h"
 
-#include <filesystem>
-#include <fstream>
-#include <sstream>
-#include <gtc/matrix_transform.hpp>
-#include <gtc/type_ptr.hpp>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "Material.h"
 
-static std::vector<Material> loadMTL(const char* file_name)
+// Parses Wavefront .mtl files straight from a mapped buffer. Lines are
+// tokenized in place and numbers read with std::from_chars, so the only
+// allocations are the materials themselves, interned names and map paths.
+// Unknown keys are skipped.
+class MaterialLibrary
 {
-	int pos = -1;
-	std::vector<Material> materials;
-	std::stringstream ss;
-	std::ifstream fin(file_name);
-	if (!fin.is_open())
-	{
-		std::cout << "Failed to load " << file_name << '\n';
-		return std::vector<Material>();
-	}
+public:
+    MaterialLibrary() = default;
+    // Material names point into this library, so it can be moved but not copied.
+    MaterialLibrary(const MaterialLibrary&) = delete;
+    MaterialLibrary& operator=(const MaterialLibrary&) = delete;
+    MaterialLibrary(MaterialLibrary&&) = default;
+    MaterialLibrary& operator=(MaterialLibrary&&) = default;
+
+    bool Load(const std::string& path);
+    // Appends the materials in text; later definitions of a name replace earlier ones.
+    void Parse(const char* text, size_t size);
+    void Clear();
+
+    const Material* Find(std::string_view name) const;
+    const std::vector<Material>& Materials() const { return materials; }
 
-	std::string line;
-	std::string prefix;
-	GLint value;
-	while (std::getline(fin, line))
-	{
-		//get prefix
-		ss.clear();
-		ss.str(line);
-		ss >> prefix;
+    // Returns the library's copy of name, adding it on first use.
+    std::string_view Intern(std::string_view name);
 
-		if (prefix == "newmtl") //vertex position
-		{
-			materials.push_back(Material());
-			pos++;
-		}
-		else
-			if (prefix == "Ka") //texture coords
-			{
-				glm::vec3 ambient;
-				ss >> ambient.x >> ambient.y >> ambient.z;
-				materials[pos].ambient = ambient;
-			}
-			else
-				if (prefix == "Kd") //vertex normals
-				{
-					glm::vec3 diffuse;
-					ss >> diffuse.x >> diffuse.y >> diffuse.z;
-					materials[pos].diffuse = diffuse;
-				}
-				else
-					if (prefix == "Ks") //vertex normals
-					{
-						glm::vec3 specular;
-						ss >> specular.x >> specular.y >> specular.z;
-						materials[pos].specular = specular;
-					}
-	}
-	//debug
-	std::cout << "MTL file " << file_name << " loaded successfully with " << pos + 1 << " materials!\n";
-	return materials;
-}
\ No newline at end of file
+private:
+    std::vector<Material> materials;
+    std::unordered_map<std::string_view, size_t> indexByName;
+    // Node-based, so interned names never move.
+    std::deque<std::string> names;
+    std::unordered_set<std::string_view> internedNames;
+};
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <GLM.hpp>
+#include <string>
+#include <string_view>
+
+// A map_* (or bump/disp/decal/refl/norm) statement: the file plus the options that may precede it.
+struct MaterialTexture
+{
+    std::string path;
+
+    bool blendU = true;         // -blendu
+    bool blendV = true;         // -blendv
+    bool clamp = false;         // -clamp
+    float boost = 0.0f;         // -boost
+    float base = 0.0f;          // -mm base gain
+    float gain = 1.0f;
+    float bumpMultiplier = 1.0f; // -bm
+    glm::vec3 offset = glm::vec3(0.0f);     // -o
+    glm::vec3 scale = glm::vec3(1.0f);      // -s
+    glm::vec3 turbulence = glm::vec3(0.0f); // -t
+    int resolution = 0;         // -texres
+    char channel = 0;           // -imfchan r|g|b|m|l|z, 0 if not given
+    std::string type;           // -type, reflection maps only
+
+    bool IsSet() const { return !path.empty(); }
+};
+
+// Everything a Wavefront .mtl material can specify, including the common PBR extension.
+struct Material
+{
+    // Interned by the MaterialLibrary that parsed it; valid while the library lives.
+    std::string_view name;
+
+    glm::vec3 ambient = glm::vec3(0.0f);            // Ka
+    glm::vec3 diffuse = glm::vec3(0.0f);            // Kd
+    glm::vec3 specular = glm::vec3(0.0f);           // Ks
+    glm::vec3 emissive = glm::vec3(0.0f);           // Ke
+    glm::vec3 transmissionFilter = glm::vec3(1.0f); // Tf
+    float shininess = 0.0f;                         // Ns
+    float opticalDensity = 1.0f;                    // Ni
+    float opacity = 1.0f;                           // d, or 1 - Tr
+    float sharpness = 60.0f;                        // sharpness
+    int illumination = 2;                           // illum
+
+    float roughness = 0.0f;          // Pr
+    float metallic = 0.0f;           // Pm
+    float sheen = 0.0f;              // Ps
+    float clearcoat = 0.0f;          // Pc
+    float clearcoatRoughness = 0.0f; // Pcr
+    float anisotropy = 0.0f;         // aniso
+    float anisotropyRotation = 0.0f; // anisor
+
+    MaterialTexture ambientMap;      // map_Ka
+    MaterialTexture diffuseMap;      // map_Kd
+    MaterialTexture specularMap;     // map_Ks
+    MaterialTexture emissiveMap;     // map_Ke
+    MaterialTexture shininessMap;    // map_Ns
+    MaterialTexture alphaMap;        // map_d
+    MaterialTexture bumpMap;         // map_bump, bump
+    MaterialTexture displacementMap; // disp
+    MaterialTexture decalMap;        // decal
+    MaterialTexture reflectionMap;   // refl
+    MaterialTexture normalMap;       // norm
+    MaterialTexture roughnessMap;    // map_Pr
+    MaterialTexture metallicMap;     // map_Pm
+    MaterialTexture sheenMap;        // map_Ps
+};
@@ -1,67 +1,259 @@
 #include "Mesh.h"
+#include "GLState.h"
+#include "Meshlets.h"
+#include "RenderStats.h"
+#include "VertexPacking.h"
 
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
+Mesh::Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices, std::vector<Texture> textures,
+    bool packVertices, bool keepCpuData)
+    : textures(std::move(textures))
 {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+    nameSamplers();
+    setupMesh(vertices.data(), vertices.size(), indices.data(), indices.size(), packVertices);
 
-    setupMesh();
+    if (keepCpuData)
+    {
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+    }
+    else
+    {
+        // The arrays were handed over, so free them now rather than with the caller's MeshData.
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+    }
 }
 
-void Mesh::setupMesh()
+Mesh::Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, std::vector<Texture> textures,
+    bool packVertices, bool keepCpuData)
+    : textures(std::move(textures))
 {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
+    nameSamplers();
+    setupMesh(vertexData, vertexCount, indexData, indexCount, packVertices);
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+    if (keepCpuData)
+    {
+        vertices.assign(vertexData, vertexData + vertexCount);
+        indices.assign(indexData, indexData + indexCount);
+    }
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+Mesh::~Mesh()
+{
+    Release();
+}
 
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+Mesh::Mesh(Mesh&& other) noexcept
+{
+    *this = std::move(other);
+}
 
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        vertices = std::move(other.vertices);
+        indices = std::move(other.indices);
+        textures = std::move(other.textures);
+        samplerNames = std::move(other.samplerNames);
+        range = other.range;
+        packed = other.packed;
+        gpuBytes = other.gpuBytes;
+        positionScale = other.positionScale;
+        positionOffset = other.positionOffset;
+        lods = std::move(other.lods);
+        meshlets = std::move(other.meshlets);
+        boundsCenter = other.boundsCenter;
+        boundsRadius = other.boundsRadius;
+        other.range = GeometryRange();
+    }
+    return *this;
+}
 
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+void Mesh::setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, bool packVertices)
+{
+    PackedVertexBounds bounds;
+    std::vector<PackedVertex> packedVertices;
+    packed = packVertices && PackVertices(vertexData, vertexCount, packedVertices, bounds);
+    positionScale = bounds.positionScale;
+    positionOffset = bounds.positionOffset;
 
-    glBindVertexArray(0);
+    std::vector<unsigned short> shortIndices;
+    GLenum indexType = vertexCount < 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (indexType == GL_UNSIGNED_SHORT)
+        shortIndices.assign(indexData, indexData + indexCount);
+
+    range = GeometryArena::Get().Allocate(packed ? VertexFormatPacked : VertexFormatFull,
+        packed ? (const void*)packedVertices.data() : (const void*)vertexData, vertexCount,
+        indexType == GL_UNSIGNED_SHORT ? (const void*)shortIndices.data() : (const void*)indexData, indexCount, indexType);
+
+    lods.assign(1, MeshLod{ 0, static_cast<unsigned int>(indexCount), 0.0f });
+
+    if (vertexCount > 0)
+    {
+        glm::vec3 minimum = vertexData[0].Position, maximum = minimum;
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            minimum = glm::min(minimum, vertexData[i].Position);
+            maximum = glm::max(maximum, vertexData[i].Position);
+        }
+        boundsCenter = (minimum + maximum) * 0.5f;
+        boundsRadius = glm::length(maximum - minimum) * 0.5f;
+    }
+
+    size_t vertexBytes = packed ? vertexCount * sizeof(PackedVertex) : vertexCount * sizeof(Vertex);
+    size_t indexBytes = indexType == GL_UNSIGNED_SHORT ? indexCount * sizeof(unsigned short) : indexCount * sizeof(unsigned int);
+    gpuBytes = vertexBytes + indexBytes;
 }
 
-void Mesh::Draw(Shader& shader)
+void Mesh::nameSamplers()
 {
+    // texture_diffuse1, texture_diffuse2, texture_specular1, ... in the order the textures appear.
     unsigned int diffuseNr = 1;
     unsigned int specularNr = 1;
     unsigned int normalNr = 1;
     unsigned int heightNr = 1;
-    for (unsigned int i = 0; i < textures.size(); i++)
+    samplerNames.clear();
+    for (const Texture& texture : textures)
     {
-        glActiveTexture(GL_TEXTURE0 + i);
         std::string number;
-        std::string name = textures[i].type;
-        if (name == "texture_diffuse")
+        if (texture.type == "texture_diffuse")
             number = std::to_string(diffuseNr++);
-        else if (name == "texture_specular")
+        else if (texture.type == "texture_specular")
             number = std::to_string(specularNr++);
-        else if (name == "texture_normal")
+        else if (texture.type == "texture_normal")
             number = std::to_string(normalNr++);
-        else if (name == "texture_height")
+        else if (texture.type == "texture_height")
             number = std::to_string(heightNr++);
+        samplerNames.push_back(UniformName(texture.type + number));
+    }
+}
 
-        glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+void Mesh::Release()
+{
+    if (!range.IsValid())
+        return;
+    GeometryArena::Get().Free(range);
+    range = GeometryRange();
+}
 
-        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+void Mesh::SetLods(const std::vector<MeshLod>& levels)
+{
+    if (levels.empty())
+        return;
+    lods = levels;
+    if (!indices.empty())
+        indices.resize(lods[0].indexCount);
+}
+
+void Mesh::SetMeshlets(std::vector<Meshlet> clusters)
+{
+    meshlets = std::move(clusters);
+}
+
+void Mesh::Draw(Shader& shader, int lod)
+{
+    GeometryArena::Get().Bind(range.format);
+    DrawBound(shader, lod);
+}
+
+void Mesh::DrawBound(Shader& shader, int lod, const MeshletCullView* cull)
+{
+    if (!range.IsValid())
+        return;
+
+    bindMaterial(shader);
+
+    const size_t levelIndex = std::min(size_t(std::max(lod, 0)), lods.size() - 1);
+    const MeshLod& level = lods[levelIndex];
+    size_t indexSize = range.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    if (cull && levelIndex == 0 && !meshlets.empty())
+        drawVisibleMeshlets(*cull, indexSize);
+    else
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, level.indexCount, range.indexType, (void*)(range.indexOffset + level.indexOffset * indexSize), range.baseVertex);
+        RenderStats::Get().AddDraw(level.indexCount / 3, lods[0].indexCount / 3);
+    }
+}
+
+void Mesh::DrawInstancedBound(Shader& shader, size_t instanceCount, int lod)
+{
+    if (!range.IsValid() || instanceCount == 0)
+        return;
+
+    bindMaterial(shader);
+
+    const MeshLod& level = lods[std::min(size_t(std::max(lod, 0)), lods.size() - 1)];
+    size_t indexSize = range.indexType == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, level.indexCount, range.indexType, (void*)(range.indexOffset + level.indexOffset * indexSize),
+        GLsizei(instanceCount), range.baseVertex);
+    RenderStats::Get().AddDraw(level.indexCount / 3 * instanceCount, lods[0].indexCount / 3 * instanceCount);
+}
+
+void Mesh::bindMaterial(Shader& shader)
+{
+    static constexpr UniformName PosScale("posScale");
+    static constexpr UniformName PosOffset("posOffset");
+    static constexpr UniformName OctNormals("octNormals");
+
+    // Samplers got fixed units when the shader was linked, so only the textures are bound here.
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        int unit = shader.SamplerUnit(samplerNames[i]);
+        // A shader that does not name the texture still finds it in slot order, as before.
+        if (unit < 0)
+            unit = int(i);
+        GLState::Get().BindTexture(unit, GL_TEXTURE_2D, textures[i].id);
+    }
+
+    // Unpacked meshes use an identity decode, since the shader is shared with packed ones.
+    shader.SetVec3(PosScale, positionScale);
+    shader.SetVec3(PosOffset, positionOffset);
+    shader.setBool(OctNormals, packed);
+}
+
+void Mesh::drawVisibleMeshlets(const MeshletCullView& cull, size_t indexSize)
+{
+    // Scratch for the multi-draw, reused across draws; GL thread only.
+    static std::vector<GLsizei> counts;
+    static std::vector<const void*> offsets;
+    static std::vector<GLint> baseVertices;
+    counts.clear();
+    offsets.clear();
+
+    // Neighbouring visible meshlets are contiguous in the index buffer, so they merge into one range.
+    size_t runStart = 0, runEnd = 0, triangles = 0, visible = 0;
+    for (const Meshlet& meshlet : meshlets)
+    {
+        if (!IsMeshletVisible(meshlet, cull))
+            continue;
+        visible++;
+        triangles += meshlet.indexCount / 3;
+        if (runEnd == meshlet.indexOffset && runEnd != runStart)
+        {
+            runEnd += meshlet.indexCount;
+            continue;
+        }
+        if (runEnd != runStart)
+        {
+            counts.push_back(GLsizei(runEnd - runStart));
+            offsets.push_back((const void*)(range.indexOffset + runStart * indexSize));
+        }
+        runStart = meshlet.indexOffset;
+        runEnd = runStart + meshlet.indexCount;
+    }
+    if (runEnd != runStart)
+    {
+        counts.push_back(GLsizei(runEnd - runStart));
+        offsets.push_back((const void*)(range.indexOffset + runStart * indexSize));
     }
 
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    RenderStats::Get().AddMeshlets(visible, meshlets.size() - visible);
+    if (counts.empty())
+        return;
 
-    glActiveTexture(GL_TEXTURE0);
+    baseVertices.assign(counts.size(), GLint(range.baseVertex));
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), range.indexType, offsets.data(), GLsizei(counts.size()), baseVertices.data());
+    RenderStats::Get().AddDraw(triangles, lods[0].indexCount / 3);
 }
\ No newline at end of file
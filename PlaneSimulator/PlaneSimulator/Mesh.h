@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <GL/glew.h>
 #include <GLM.hpp>
@@ -7,6 +8,7 @@
 #include <glfw3.h>
 #include <string>
 #include "Shader.h" 
+#include "GeometryArena.h"
 
 struct Vertex
 {
@@ -24,20 +26,122 @@ struct Texture
     std::string path;
 };
 
+// Material texture reference as stored in the mesh cache, before it is loaded.
+struct TextureRef
+{
+    std::string type;
+    std::string path;
+};
+
+// One level of detail: a run of the mesh's indices over its shared vertices.
+struct MeshLod
+{
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    // Largest distance the surface moved from the full-detail mesh, in model units.
+    float error;
+};
+
+// Cluster of full-detail triangles (see Meshlets.h): a run of the index
+// buffer plus the bounds needed to cull it, in model space.
+struct Meshlet
+{
+    unsigned int indexOffset;
+    unsigned int indexCount;
+    glm::vec3 center;
+    float radius;
+    // Normal cone: every triangle normal lies within it. coneCutoff is the sine
+    // of its half-angle, or 1 if the cluster cannot be back-face culled.
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+struct MeshletCullView;
+
+// CPU-side result of importing one mesh, uploaded later on the GL thread.
+struct MeshData
+{
+    std::vector<Vertex> vertices;
+    // Every level of detail back to back, full detail first.
+    std::vector<unsigned int> indices;
+    std::vector<TextureRef> textures;
+    // Empty when indices holds a single level (see MeshSimplifier.h).
+    std::vector<MeshLod> lods;
+    // Clusters of the full-detail level (see Meshlets.h); empty for small meshes.
+    std::vector<Meshlet> meshlets;
+};
+
+// Owns its range of the GeometryArena and returns it when destroyed, so it
+// can be moved but not copied.
 class Mesh
 {
 public:
 
+    // CPU copy of the geometry; empty unless the mesh was created with keepCpuData.
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
 
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
-    void Draw(Shader& shader);
+    // packVertices uploads the 16-byte PackedVertex layout (see VertexPacking.h) when the mesh fits it.
+    Mesh(std::vector<Vertex>&& vertices, std::vector<unsigned int>&& indices, std::vector<Texture> textures,
+        bool packVertices = false, bool keepCpuData = false);
+    // Uploads straight from caller-owned arrays (e.g. a mapped mesh cache); they are only copied with keepCpuData.
+    Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, std::vector<Texture> textures,
+        bool packVertices = false, bool keepCpuData = false);
+    ~Mesh();
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
+
+    void Draw(Shader& shader, int lod = 0);
+    // Draw without binding; the arena VAO for Format() must already be bound.
+    // Levels past the coarsest one draw the coarsest. With a cull view, the
+    // full-detail level submits only the meshlets that pass IsMeshletVisible.
+    void DrawBound(Shader& shader, int lod = 0, const MeshletCullView* cull = nullptr);
+    // Draws instanceCount copies in one call; the arena's instanced VAO for Format() must be bound.
+    void DrawInstancedBound(Shader& shader, size_t instanceCount, int lod = 0);
+    // Returns the geometry to the arena early; the mesh must not be drawn afterwards.
+    void Release();
+
+    // Describes the levels packed into the uploaded indices; the CPU copy keeps only full detail.
+    void SetLods(const std::vector<MeshLod>& levels);
+    size_t LodCount() const { return lods.size(); }
+    float LodError(size_t lod) const { return lods[std::min(lod, lods.size() - 1)].error; }
+
+    void SetMeshlets(std::vector<Meshlet> clusters);
+    size_t MeshletCount() const { return meshlets.size(); }
+
+    VertexFormat Format() const { return range.format; }
+    // Bounding sphere in model space.
+    const glm::vec3& BoundsCenter() const { return boundsCenter; }
+    float BoundsRadius() const { return boundsRadius; }
+
+    bool IsPacked() const { return packed; }
+    // Size of the vertex and index buffers on the GPU.
+    size_t GpuBytes() const { return gpuBytes; }
 
 private:
 
-    unsigned int VAO, VBO, EBO;
+    // Index type is GL_UNSIGNED_SHORT when the mesh has fewer than 65536 vertices.
+    GeometryRange range;
+    bool packed = false;
+    size_t gpuBytes = 0;
+    // Packed positions decode as position * positionScale + positionOffset.
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+    // Sampler uniform each texture binds to, hashed once from its type.
+    std::vector<UniformName> samplerNames;
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
 
-    void setupMesh();
+    // Submits the meshlets of the full-detail level that pass the cull test with one multi-draw.
+    void drawVisibleMeshlets(const MeshletCullView& cull, size_t indexSize);
+    // Binds the textures and sets the vertex decode uniforms.
+    void bindMaterial(Shader& shader);
+    void nameSamplers();
+    void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, bool packVertices);
 };
\ No newline at end of file
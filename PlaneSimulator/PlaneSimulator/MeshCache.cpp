@@ -0,0 +1,340 @@
+#include "MeshCache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char CacheMagic[4] = { 'G', '3', 'D', 'M' };
+    const size_t DataAlignment = 16;
+
+    struct MeshCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t vertexSize;
+        uint32_t meshCount;
+    };
+
+    static_assert(sizeof(MeshLod) == 12, "MeshLod is stored in the cache as is");
+    static_assert(sizeof(Meshlet) == 40, "Meshlet is stored in the cache as is");
+
+    struct MeshCacheEntry
+    {
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t textureCount;
+        uint32_t lodCount;
+        uint32_t meshletCount;
+        uint32_t reserved;
+        uint64_t textureOffset;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+    };
+
+    size_t alignUp(size_t value)
+    {
+        return (value + DataAlignment - 1) & ~(DataAlignment - 1);
+    }
+
+    // FNV-1a over 64-bit words, folding in the tail bytes and the total length.
+    uint64_t hashBytes(const unsigned char* data, size_t size)
+    {
+        const uint64_t prime = 1099511628211ull;
+        uint64_t hash = 1469598103934665603ull;
+
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * prime;
+        }
+        for (; i < size; i++)
+            hash = (hash ^ data[i]) * prime;
+
+        return (hash ^ static_cast<uint64_t>(size)) * prime;
+    }
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // Folds in every file the OBJ's "mtllib" statements name (several per line are allowed),
+    // resolved next to the source as ObjImporter does.
+    // A missing library still changes the hash, so creating it later invalidates the cache.
+    uint64_t hashMaterialLibraries(const std::string& sourcePath, const char* text, size_t size, uint64_t hash)
+    {
+        const uint64_t prime = 1099511628211ull;
+        const std::string directory = sourcePath.substr(0, sourcePath.find_last_of("\\/") + 1);
+        const char* p = text;
+        const char* end = text + size;
+        while (p < end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            if (!lineEnd)
+                lineEnd = end;
+            const char* line = p;
+            p = lineEnd + 1;
+
+            while (line < lineEnd && isSpace(*line))
+                line++;
+            if (lineEnd - line <= 6 || std::memcmp(line, "mtllib", 6) != 0 || !isSpace(line[6]))
+                continue;
+
+            const char* name = line + 6;
+            for (;;)
+            {
+                while (name < lineEnd && isSpace(*name))
+                    name++;
+                if (name == lineEnd)
+                    break;
+                const char* nameEnd = name;
+                while (nameEnd < lineEnd && !isSpace(*nameEnd))
+                    nameEnd++;
+
+                MappedFile library(directory + std::string(name, nameEnd));
+                uint64_t libraryHash = library.IsOpen() ? hashBytes(library.Data(), library.Size()) : 0;
+                hash = (hash ^ libraryHash) * prime;
+                name = nameEnd;
+            }
+        }
+        return hash;
+    }
+
+    void writePadding(std::ofstream& out, size_t& offset)
+    {
+        static const char zeros[DataAlignment] = {};
+        size_t aligned = alignUp(offset);
+        out.write(zeros, aligned - offset);
+        offset = aligned;
+    }
+}
+
+uint64_t MeshCache::HashSource(const std::string& sourcePath)
+{
+    MappedFile source(sourcePath);
+    if (!source.IsOpen())
+        return 0;
+
+    uint64_t hash = hashBytes(source.Data(), source.Size());
+    hash = hashMaterialLibraries(sourcePath, reinterpret_cast<const char*>(source.Data()), source.Size(), hash);
+    return hash != 0 ? hash : 1;
+}
+
+std::string MeshCache::CachePath(const std::string& sourcePath, uint32_t variant)
+{
+    if (variant == 0)
+        return sourcePath + ".meshcache";
+    return sourcePath + "." + std::to_string(variant) + ".meshcache";
+}
+
+bool MeshCache::Open(const std::string& sourcePath, uint32_t variant, uint64_t sourceHash)
+{
+    meshes.clear();
+    if (!file.Open(CachePath(sourcePath, variant)))
+        return false;
+
+    const unsigned char* base = file.Data();
+    const size_t size = file.Size();
+
+    MeshCacheHeader header;
+    if (size < sizeof(header))
+    {
+        file.Close();
+        return false;
+    }
+    std::memcpy(&header, base, sizeof(header));
+
+    if (std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0 || header.version != Version ||
+        header.vertexSize != sizeof(Vertex) || header.sourceHash != sourceHash)
+    {
+        file.Close();
+        return false;
+    }
+
+    const size_t tableEnd = sizeof(header) + header.meshCount * sizeof(MeshCacheEntry);
+    if (tableEnd > size)
+    {
+        file.Close();
+        return false;
+    }
+
+    meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++)
+    {
+        MeshCacheEntry entry;
+        std::memcpy(&entry, base + sizeof(header) + i * sizeof(MeshCacheEntry), sizeof(entry));
+
+        const uint64_t vertexEnd = entry.vertexOffset + uint64_t(entry.vertexCount) * sizeof(Vertex);
+        const uint64_t indexEnd = entry.indexOffset + uint64_t(entry.indexCount) * sizeof(unsigned int);
+        if (vertexEnd > size || indexEnd > size || entry.vertexOffset % DataAlignment || entry.indexOffset % DataAlignment)
+        {
+            meshes.clear();
+            file.Close();
+            return false;
+        }
+
+        CachedMesh& mesh = meshes[i];
+        mesh.vertices = reinterpret_cast<const Vertex*>(base + entry.vertexOffset);
+        mesh.vertexCount = entry.vertexCount;
+        mesh.indices = reinterpret_cast<const unsigned int*>(base + entry.indexOffset);
+        mesh.indexCount = entry.indexCount;
+
+        uint64_t cursor = entry.textureOffset;
+        for (uint32_t t = 0; t < entry.textureCount; t++)
+        {
+            uint32_t lengths[2];
+            if (cursor + sizeof(lengths) > size)
+            {
+                meshes.clear();
+                file.Close();
+                return false;
+            }
+            std::memcpy(lengths, base + cursor, sizeof(lengths));
+            cursor += sizeof(lengths);
+            if (cursor + lengths[0] + lengths[1] > size)
+            {
+                meshes.clear();
+                file.Close();
+                return false;
+            }
+
+            TextureRef ref;
+            ref.type.assign(reinterpret_cast<const char*>(base + cursor), lengths[0]);
+            ref.path.assign(reinterpret_cast<const char*>(base + cursor + lengths[0]), lengths[1]);
+            cursor += lengths[0] + lengths[1];
+            mesh.textures.push_back(ref);
+        }
+
+        if (cursor + uint64_t(entry.lodCount) * sizeof(MeshLod) + uint64_t(entry.meshletCount) * sizeof(Meshlet) > size)
+        {
+            meshes.clear();
+            file.Close();
+            return false;
+        }
+        mesh.lods.resize(entry.lodCount);
+        if (entry.lodCount)
+            std::memcpy(mesh.lods.data(), base + cursor, entry.lodCount * sizeof(MeshLod));
+        cursor += entry.lodCount * sizeof(MeshLod);
+        mesh.meshlets.resize(entry.meshletCount);
+        if (entry.meshletCount)
+            std::memcpy(mesh.meshlets.data(), base + cursor, entry.meshletCount * sizeof(Meshlet));
+
+        bool rangesValid = true;
+        for (const MeshLod& lod : mesh.lods)
+            rangesValid &= uint64_t(lod.indexOffset) + lod.indexCount <= entry.indexCount;
+        for (const Meshlet& meshlet : mesh.meshlets)
+            rangesValid &= uint64_t(meshlet.indexOffset) + meshlet.indexCount <= entry.indexCount;
+        if (!rangesValid)
+        {
+            meshes.clear();
+            file.Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool MeshCache::Write(const std::string& sourcePath, uint32_t variant, uint64_t sourceHash, const std::vector<MeshData>& meshes)
+{
+    const std::string cachePath = CachePath(sourcePath, variant);
+
+    // Lay out every section first so the entry table can be written up front.
+    std::vector<MeshCacheEntry> entries(meshes.size());
+    size_t offset = sizeof(MeshCacheHeader) + meshes.size() * sizeof(MeshCacheEntry);
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        const MeshData& mesh = meshes[i];
+        MeshCacheEntry& entry = entries[i];
+        entry.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        entry.indexCount = static_cast<uint32_t>(mesh.indices.size());
+        entry.textureCount = static_cast<uint32_t>(mesh.textures.size());
+        entry.lodCount = static_cast<uint32_t>(mesh.lods.size());
+        entry.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+        entry.reserved = 0;
+
+        entry.textureOffset = offset;
+        for (const TextureRef& texture : mesh.textures)
+            offset += 2 * sizeof(uint32_t) + texture.type.size() + texture.path.size();
+        offset += mesh.lods.size() * sizeof(MeshLod);
+        offset += mesh.meshlets.size() * sizeof(Meshlet);
+
+        offset = alignUp(offset);
+        entry.vertexOffset = offset;
+        offset += mesh.vertices.size() * sizeof(Vertex);
+
+        offset = alignUp(offset);
+        entry.indexOffset = offset;
+        offset += mesh.indices.size() * sizeof(unsigned int);
+    }
+
+    // Written aside and renamed over the cache, so a crash or a concurrent reader never sees a partial file.
+    const std::string tempPath = cachePath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open())
+    {
+        std::cout << "ERROR::MESHCACHE::Could not write " << tempPath << std::endl;
+        return false;
+    }
+
+    MeshCacheHeader header;
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = Version;
+    header.sourceHash = sourceHash;
+    header.vertexSize = sizeof(Vertex);
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!entries.empty())
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(MeshCacheEntry));
+
+    offset = sizeof(MeshCacheHeader) + meshes.size() * sizeof(MeshCacheEntry);
+    for (const MeshData& mesh : meshes)
+    {
+        for (const TextureRef& texture : mesh.textures)
+        {
+            uint32_t lengths[2] = { static_cast<uint32_t>(texture.type.size()), static_cast<uint32_t>(texture.path.size()) };
+            out.write(reinterpret_cast<const char*>(lengths), sizeof(lengths));
+            out.write(texture.type.data(), texture.type.size());
+            out.write(texture.path.data(), texture.path.size());
+            offset += sizeof(lengths) + texture.type.size() + texture.path.size();
+        }
+        if (!mesh.lods.empty())
+            out.write(reinterpret_cast<const char*>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+        offset += mesh.lods.size() * sizeof(MeshLod);
+        if (!mesh.meshlets.empty())
+            out.write(reinterpret_cast<const char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+        offset += mesh.meshlets.size() * sizeof(Meshlet);
+
+        writePadding(out, offset);
+        out.write(reinterpret_cast<const char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(Vertex));
+        offset += mesh.vertices.size() * sizeof(Vertex);
+
+        writePadding(out, offset);
+        out.write(reinterpret_cast<const char*>(mesh.indices.data()), mesh.indices.size() * sizeof(unsigned int));
+        offset += mesh.indices.size() * sizeof(unsigned int);
+    }
+
+    out.close();
+    if (!out)
+    {
+        std::remove(tempPath.c_str());
+        std::cout << "ERROR::MESHCACHE::Failed writing " << tempPath << std::endl;
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+    {
+        std::remove(tempPath.c_str());
+        std::cout << "ERROR::MESHCACHE::Could not replace " << cachePath << ": " << error.message() << std::endl;
+        return false;
+    }
+    return true;
+}
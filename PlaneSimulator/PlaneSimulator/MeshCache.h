@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Mesh.h"
+
+// Binary cache of the final per-mesh vertex/index arrays of an imported model.
+// The cache lives next to the source file and is keyed by a hash of the source
+// bytes and of the .mtl libraries it references, so an edited OBJ or material
+// file is re-imported automatically. On a hit the arrays are used in place
+// from the mapped file and handed to glBufferData unchanged.
+//
+// Layout (version 6, little endian, all offsets from the start of the file):
+//   MeshCacheHeader
+//   MeshCacheEntry[meshCount]
+//   per mesh: texture refs (u32 typeLength, u32 pathLength, chars), MeshLod[lodCount],
+//             Meshlet[meshletCount], then Vertex[vertexCount] and u32[indexCount],
+//             both 16-byte aligned
+struct CachedMesh
+{
+    const Vertex* vertices = nullptr;
+    size_t vertexCount = 0;
+    const unsigned int* indices = nullptr;
+    size_t indexCount = 0;
+    std::vector<TextureRef> textures;
+    std::vector<MeshLod> lods;
+    std::vector<Meshlet> meshlets;
+};
+
+class MeshCache
+{
+public:
+    static const uint32_t Version = 6;
+
+    // Hash identifying the current contents of sourcePath and its mtllib files; 0 if the source cannot be read.
+    static uint64_t HashSource(const std::string& sourcePath);
+    // Imports that build different meshes from the same source (see Model::Import)
+    // pass different variants and get a file each; variant 0 is <source>.meshcache.
+    static std::string CachePath(const std::string& sourcePath, uint32_t variant = 0);
+
+    // Maps the cache for sourcePath; fails if it is missing, stale or malformed.
+    bool Open(const std::string& sourcePath, uint32_t variant, uint64_t sourceHash);
+    static bool Write(const std::string& sourcePath, uint32_t variant, uint64_t sourceHash, const std::vector<MeshData>& meshes);
+
+    size_t MeshCount() const { return meshes.size(); }
+    const CachedMesh& GetMesh(size_t index) const { return meshes[index]; }
+
+private:
+    MappedFile file;
+    std::vector<CachedMesh> meshes;
+};
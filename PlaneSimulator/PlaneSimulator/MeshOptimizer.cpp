@@ -0,0 +1,353 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+    // Forsyth's scoring constants; the LRU cache he models is larger than the FIFO we measure with.
+    const unsigned int ForsythCacheSize = 32;
+    const float CacheDecayPower = 1.5f;
+    const float LastTriangleScore = 0.75f;
+    const float ValenceBoostScale = 2.0f;
+    const float ValenceBoostPower = 0.5f;
+
+    const size_t NoTriangle = std::numeric_limits<size_t>::max();
+
+    float vertexScore(int cachePosition, unsigned int remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // The three vertices of the last triangle get a fixed score so the next
+            // triangle does not simply reuse the same edge every time.
+            if (cachePosition < 3)
+                score = LastTriangleScore;
+            else
+                score = std::pow(1.0f - float(cachePosition - 3) / (ForsythCacheSize - 3), CacheDecayPower);
+        }
+        // Vertices with few triangles left are finished off first.
+        return score + ValenceBoostScale * std::pow(float(remainingTriangles), -ValenceBoostPower);
+    }
+
+    static_assert(sizeof(Vertex) == 14 * sizeof(float), "Vertex must not contain padding for bitwise welding");
+
+    struct VertexHasher
+    {
+        const std::vector<Vertex>* vertices;
+
+        size_t operator()(unsigned int index) const
+        {
+            uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+            std::memcpy(words, &(*vertices)[index], sizeof(Vertex));
+            size_t hash = 2166136261u;
+            for (uint32_t word : words)
+                hash = (hash ^ word) * 16777619u;
+            return hash;
+        }
+    };
+
+    struct VertexEqual
+    {
+        const std::vector<Vertex>* vertices;
+
+        bool operator()(unsigned int a, unsigned int b) const
+        {
+            return std::memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(Vertex)) == 0;
+        }
+    };
+}
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+    VertexCacheStats stats;
+    if (indices.size() < 3)
+        return stats;
+
+    // A vertex is still cached if fewer than cacheSize misses happened since it was loaded.
+    std::vector<unsigned int> loadedAt(vertexCount, 0);
+    std::vector<char> used(vertexCount, 0);
+    unsigned int timestamp = cacheSize + 1;
+    size_t transformed = 0, unique = 0;
+    for (unsigned int index : indices)
+    {
+        if (timestamp - loadedAt[index] > cacheSize)
+        {
+            loadedAt[index] = timestamp++;
+            transformed++;
+        }
+        if (!used[index])
+        {
+            used[index] = 1;
+            unique++;
+        }
+    }
+
+    stats.acmr = float(transformed) / (indices.size() / 3);
+    stats.atvr = float(transformed) / unique;
+    return stats;
+}
+
+void WeldVertices(MeshData& mesh)
+{
+    const std::vector<Vertex>& vertices = mesh.vertices;
+    std::unordered_map<unsigned int, unsigned int, VertexHasher, VertexEqual> unique(
+        vertices.size(), VertexHasher{ &vertices }, VertexEqual{ &vertices });
+
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+        auto inserted = unique.emplace(i, static_cast<unsigned int>(welded.size()));
+        if (inserted.second)
+            welded.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+
+    for (unsigned int& index : mesh.indices)
+        index = remap[index];
+    mesh.vertices.swap(welded);
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Per-vertex lists of the triangles not emitted yet; the live ones are
+    // kept at the front of each list, remaining[v] long.
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (unsigned int index : indices)
+        remaining[index]++;
+
+    std::vector<size_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<size_t> adjacency(indices.size());
+    {
+        std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[cursor[indices[i]]++] = i / 3;
+    }
+
+    std::vector<float> scores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        scores[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+    size_t bestTriangle = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[bestTriangle])
+            bestTriangle = t;
+    }
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, nextCache;
+    cache.reserve(ForsythCacheSize + 3);
+    nextCache.reserve(ForsythCacheSize + 3);
+    size_t scanCursor = 0;
+
+    for (size_t n = 0; n < triangleCount; n++)
+    {
+        // Nothing in the cache has triangles left: continue with the next unused triangle.
+        if (bestTriangle == NoTriangle)
+        {
+            while (emitted[scanCursor])
+                scanCursor++;
+            bestTriangle = scanCursor;
+        }
+
+        const size_t triangle = bestTriangle;
+        const unsigned int* corners = &indices[triangle * 3];
+        emitted[triangle] = 1;
+        result.insert(result.end(), corners, corners + 3);
+
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int v = corners[c];
+            size_t* list = &adjacency[offsets[v]];
+            size_t* found = std::find(list, list + remaining[v], triangle);
+            std::swap(*found, list[remaining[v] - 1]);
+            remaining[v]--;
+        }
+
+        // The emitted triangle moves to the front of the LRU cache.
+        nextCache.clear();
+        for (int c = 0; c < 3; c++)
+        {
+            if (std::find(nextCache.begin(), nextCache.end(), corners[c]) == nextCache.end())
+                nextCache.push_back(corners[c]);
+        }
+        for (unsigned int v : cache)
+        {
+            if (v != corners[0] && v != corners[1] && v != corners[2])
+                nextCache.push_back(v);
+        }
+        cache.swap(nextCache);
+
+        // Rescore every vertex whose cache position changed, including the evicted ones.
+        for (size_t i = 0; i < cache.size(); i++)
+        {
+            unsigned int v = cache[i];
+            int position = i < ForsythCacheSize ? static_cast<int>(i) : -1;
+
+            float score = vertexScore(position, remaining[v]);
+            float delta = score - scores[v];
+            scores[v] = score;
+            for (size_t j = 0; j < remaining[v]; j++)
+                triangleScores[adjacency[offsets[v] + j]] += delta;
+        }
+        if (cache.size() > ForsythCacheSize)
+            cache.resize(ForsythCacheSize);
+
+        bestTriangle = NoTriangle;
+        float bestScore = -std::numeric_limits<float>::max();
+        for (unsigned int v : cache)
+        {
+            for (size_t j = 0; j < remaining[v]; j++)
+            {
+                size_t t = adjacency[offsets[v] + j];
+                if (triangleScores[t] > bestScore)
+                {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+    }
+
+    indices.swap(result);
+}
+
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // Clusters start wherever the cache order had to restart, i.e. a triangle
+    // with all three vertices missing the cache. Reordering whole clusters
+    // keeps most of the cache locality inside them.
+    std::vector<size_t> clusterStarts;
+    {
+        std::vector<unsigned int> loadedAt(vertices.size(), 0);
+        unsigned int timestamp = SimulatedCacheSize + 1;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            int misses = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                unsigned int v = indices[t * 3 + c];
+                if (timestamp - loadedAt[v] > SimulatedCacheSize)
+                {
+                    loadedAt[v] = timestamp++;
+                    misses++;
+                }
+            }
+            if (misses == 3 || t == 0)
+                clusterStarts.push_back(t);
+        }
+    }
+    if (clusterStarts.size() < 2)
+        return;
+    clusterStarts.push_back(triangleCount);
+
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    std::vector<glm::vec3> clusterCentroids(clusterStarts.size() - 1, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterStarts.size() - 1, glm::vec3(0.0f));
+    for (size_t c = 0; c + 1 < clusterStarts.size(); c++)
+    {
+        float clusterArea = 0.0f;
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+        {
+            const glm::vec3& a = vertices[indices[t * 3]].Position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].Position;
+            glm::vec3 normal = glm::cross(b - a, d - a);
+            float area = glm::length(normal);
+            glm::vec3 centroid = (a + b + d) / 3.0f;
+
+            clusterNormals[c] += normal;
+            clusterCentroids[c] += centroid * area;
+            clusterArea += area;
+            meshCentroid += centroid * area;
+            meshArea += area;
+        }
+        if (clusterArea > 0.0f)
+            clusterCentroids[c] /= clusterArea;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters facing away from the centre of the mesh tend to occlude the
+    // rest when seen from outside, so they are drawn first.
+    std::vector<float> keys(clusterCentroids.size());
+    std::vector<size_t> order(clusterCentroids.size());
+    for (size_t c = 0; c < order.size(); c++)
+    {
+        float length = glm::length(clusterNormals[c]);
+        glm::vec3 normal = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+        keys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<unsigned int> sorted;
+    sorted.reserve(indices.size());
+    for (size_t c : order)
+        sorted.insert(sorted.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+
+    if (AnalyzeVertexCache(sorted, vertices.size()).acmr <= AnalyzeVertexCache(indices, vertices.size()).acmr * threshold)
+        indices.swap(sorted);
+}
+
+void OptimizeVertexFetch(MeshData& mesh)
+{
+    const unsigned int Unused = std::numeric_limits<unsigned int>::max();
+    std::vector<unsigned int> remap(mesh.vertices.size(), Unused);
+    std::vector<Vertex> ordered;
+    ordered.reserve(mesh.vertices.size());
+
+    for (unsigned int& index : mesh.indices)
+    {
+        if (remap[index] == Unused)
+        {
+            remap[index] = static_cast<unsigned int>(ordered.size());
+            ordered.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(ordered);
+}
+
+MeshOptimizationStats OptimizeMesh(MeshData& mesh)
+{
+    MeshOptimizationStats stats;
+    stats.verticesBefore = mesh.vertices.size();
+    stats.triangles = mesh.indices.size() / 3;
+    stats.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    WeldVertices(mesh);
+    OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    OptimizeOverdraw(mesh.indices, mesh.vertices);
+    OptimizeVertexFetch(mesh);
+
+    stats.verticesAfter = mesh.vertices.size();
+    stats.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    return stats;
+}
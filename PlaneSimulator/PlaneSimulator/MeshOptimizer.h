@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Mesh.h"
+
+// Import-time index/vertex reordering so the GPU transforms each vertex fewer
+// times, shades fewer hidden pixels and fetches vertices sequentially. None of
+// the passes change what is drawn; they only reorder and deduplicate.
+
+// Post-transform cache efficiency of an index buffer under a FIFO cache.
+struct VertexCacheStats
+{
+    // Average cache miss ratio: transformed vertices per triangle (0.5 ideal, 3 worst).
+    float acmr = 0.0f;
+    // Average transform to vertex ratio: transformed vertices per unique vertex (1 ideal).
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationStats
+{
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    size_t triangles = 0;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// FIFO size the statistics are measured with, matching typical desktop hardware.
+const unsigned int SimulatedCacheSize = 16;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = SimulatedCacheSize);
+
+// Merges bitwise identical vertices and rewrites the indices to match.
+void WeldVertices(MeshData& mesh);
+// Reorders triangles for the post-transform cache (Forsyth's linear-speed algorithm).
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+// Splits the cache-ordered triangles into clusters and draws outward-facing
+// clusters first, keeping the result only if the ACMR grows by less than threshold.
+void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = 1.05f);
+// Renumbers vertices in first-use order and drops unreferenced ones.
+void OptimizeVertexFetch(MeshData& mesh);
+
+// Runs all of the above in order.
+MeshOptimizationStats OptimizeMesh(MeshData& mesh);
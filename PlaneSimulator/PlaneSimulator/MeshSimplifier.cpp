@@ -0,0 +1,346 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+#include "MeshOptimizer.h"
+
+namespace
+{
+    // Per level: the fraction of the full triangle count to aim for, and the
+    // largest error allowed for it as a fraction of the mesh's bounding box diagonal.
+    const float LodTriangleRatios[MaxLodCount - 1] = { 0.5f, 0.25f, 0.125f };
+    const float LodRelativeErrors[MaxLodCount - 1] = { 0.005f, 0.015f, 0.04f };
+    // A level that keeps more than this fraction of the previous one is not worth its index memory.
+    const float MinimumLodReduction = 0.9f;
+
+    // Sum of squared distances to a set of planes, weighted by triangle area:
+    // the symmetric matrix A (xx xy xz yy yz zz), the vector b and the constant c
+    // of v.A.v + 2 b.v + c.
+    struct Quadric
+    {
+        double a[6] = {};
+        double b[3] = {};
+        double c = 0.0;
+        double weight = 0.0;
+
+        void AddPlane(const glm::dvec3& n, double d, double w)
+        {
+            a[0] += w * n.x * n.x; a[1] += w * n.x * n.y; a[2] += w * n.x * n.z;
+            a[3] += w * n.y * n.y; a[4] += w * n.y * n.z; a[5] += w * n.z * n.z;
+            b[0] += w * n.x * d; b[1] += w * n.y * d; b[2] += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric& other)
+        {
+            for (int i = 0; i < 6; i++)
+                a[i] += other.a[i];
+            for (int i = 0; i < 3; i++)
+                b[i] += other.b[i];
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // Area-weighted sum of squared distances from p to the planes.
+        double Evaluate(const glm::vec3& p) const
+        {
+            double x = p.x, y = p.y, z = p.z;
+            double result = a[0] * x * x + 2.0 * a[1] * x * y + 2.0 * a[2] * x * z
+                + a[3] * y * y + 2.0 * a[4] * y * z + a[5] * z * z
+                + 2.0 * (b[0] * x + b[1] * y + b[2] * z) + c;
+            return std::max(result, 0.0);
+        }
+    };
+
+    // Bitwise key over the first count floats of a vertex (position, then texture coordinates).
+    struct VertexKey
+    {
+        float values[5];
+        int count;
+
+        bool operator==(const VertexKey& other) const
+        {
+            return std::memcmp(values, other.values, count * sizeof(float)) == 0;
+        }
+    };
+
+    struct VertexKeyHasher
+    {
+        size_t operator()(const VertexKey& key) const
+        {
+            size_t hash = 2166136261u;
+            for (int i = 0; i < key.count; i++)
+            {
+                uint32_t word;
+                std::memcpy(&word, &key.values[i], sizeof(word));
+                hash = (hash ^ word) * 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    VertexKey makeKey(const Vertex& vertex, bool withTexCoords)
+    {
+        VertexKey key = { { vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.TexCoords.x, vertex.TexCoords.y }, withTexCoords ? 5 : 3 };
+        return key;
+    }
+
+    // remap[v] is the first vertex matching v's key.
+    std::vector<unsigned int> buildRemap(const std::vector<Vertex>& vertices, bool withTexCoords)
+    {
+        std::unordered_map<VertexKey, unsigned int, VertexKeyHasher> first(vertices.size());
+        std::vector<unsigned int> remap(vertices.size());
+        for (unsigned int v = 0; v < vertices.size(); v++)
+            remap[v] = first.emplace(makeKey(vertices[v], withTexCoords), v).first->second;
+        return remap;
+    }
+
+    struct Collapse
+    {
+        unsigned int from;
+        unsigned int to;
+        double error;
+    };
+
+    // Triangles around each position, as offsets into one flat list.
+    struct Adjacency
+    {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+
+        void Build(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& position, size_t vertexCount)
+        {
+            offsets.assign(vertexCount + 1, 0);
+            for (unsigned int index : indices)
+                offsets[position[index] + 1]++;
+            for (size_t v = 0; v < vertexCount; v++)
+                offsets[v + 1] += offsets[v];
+
+            triangles.resize(indices.size());
+            std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+                triangles[cursor[position[indices[i]]]++] = static_cast<unsigned int>(i / 3);
+        }
+    };
+}
+
+std::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float maxError, float& error)
+{
+    error = 0.0f;
+    const size_t vertexCount = vertices.size();
+
+    // Collapses work on wedges (vertices that differ only in their normal) and
+    // on positions, which every wedge at the same place shares.
+    std::vector<unsigned int> wedge = buildRemap(vertices, true);
+    std::vector<unsigned int> position = buildRemap(vertices, false);
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        unsigned int a = wedge[indices[i]], b = wedge[indices[i + 1]], c = wedge[indices[i + 2]];
+        if (position[a] == position[b] || position[b] == position[c] || position[c] == position[a])
+            continue;
+        result.push_back(a);
+        result.push_back(b);
+        result.push_back(c);
+    }
+
+    // A position is locked if it has several wedges (a UV seam) or an edge
+    // without a twin going the other way (an open border or non-manifold edge).
+    std::vector<unsigned char> locked(vertexCount, 0);
+    {
+        std::vector<unsigned int> wedgesAtPosition(vertexCount, 0);
+        for (unsigned int v = 0; v < vertexCount; v++)
+        {
+            if (wedge[v] == v)
+                wedgesAtPosition[position[v]]++;
+        }
+        for (unsigned int v = 0; v < vertexCount; v++)
+        {
+            if (wedgesAtPosition[v] > 1)
+                locked[v] = 1;
+        }
+
+        std::unordered_map<uint64_t, unsigned int> edges(result.size());
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            uint64_t from = position[result[i]];
+            uint64_t to = position[result[i - i % 3 + (i + 1) % 3]];
+            edges[(from << 32) | to]++;
+        }
+        for (const auto& edge : edges)
+        {
+            uint64_t from = edge.first >> 32, to = edge.first & 0xFFFFFFFFu;
+            auto twin = edges.find((to << 32) | from);
+            if (edge.second > 1 || twin == edges.end() || twin->second != edge.second)
+                locked[from] = locked[to] = 1;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        glm::dvec3 p0 = vertices[result[i]].Position, p1 = vertices[result[i + 1]].Position, p2 = vertices[result[i + 2]].Position;
+        glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+        double length = glm::length(normal);
+        if (length == 0.0)
+            continue;
+        normal /= length;
+        double d = -glm::dot(normal, p0);
+        for (int k = 0; k < 3; k++)
+            quadrics[position[result[i + k]]].AddPlane(normal, d, length * 0.5);
+    }
+
+    auto collapseError = [&](unsigned int from, unsigned int to)
+    {
+        Quadric sum = quadrics[position[from]];
+        sum.Add(quadrics[position[to]]);
+        return sum.weight > 0.0 ? sum.Evaluate(vertices[to].Position) / sum.weight : 0.0;
+    };
+
+    const size_t targetTriangles = targetIndexCount / 3;
+    const double maxErrorSquared = double(maxError) * maxError;
+    double resultErrorSquared = 0.0;
+
+    Adjacency adjacency;
+    std::vector<Collapse> candidates;
+    std::vector<unsigned int> collapseTo(vertexCount);
+    std::vector<unsigned char> touched(vertexCount);
+
+    // Each pass collapses the cheapest edges whose neighbourhoods do not
+    // overlap, then rebuilds; stale neighbourhoods could hide flipped triangles.
+    while (result.size() / 3 > targetTriangles)
+    {
+        adjacency.Build(result, position, vertexCount);
+
+        candidates.clear();
+        for (size_t i = 0; i < result.size(); i++)
+        {
+            unsigned int from = result[i];
+            unsigned int to = result[i - i % 3 + (i + 1) % 3];
+            // The twin edge in the neighbouring triangle supplies the opposite direction.
+            if (!locked[position[from]])
+                candidates.push_back({ from, to, collapseError(from, to) });
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        for (unsigned int v = 0; v < vertexCount; v++)
+            collapseTo[v] = v;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t triangles = result.size() / 3;
+        size_t collapses = 0;
+        for (const Collapse& collapse : candidates)
+        {
+            if (collapse.error > maxErrorSquared || triangles <= targetTriangles)
+                break;
+
+            unsigned int from = position[collapse.from], to = position[collapse.to];
+            if (touched[from] || touched[to])
+                continue;
+
+            // Reject the collapse if any surviving triangle around from would flip.
+            bool flips = false;
+            size_t removed = 0;
+            const glm::vec3& target = vertices[collapse.to].Position;
+            for (unsigned int t = adjacency.offsets[from]; t < adjacency.offsets[from + 1] && !flips; t++)
+            {
+                const unsigned int* triangle = &result[adjacency.triangles[t] * 3];
+                glm::vec3 before[3], after[3];
+                bool collapsesAway = false;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int p = position[triangle[k]];
+                    before[k] = vertices[triangle[k]].Position;
+                    after[k] = p == from ? target : before[k];
+                    collapsesAway |= p == to;
+                }
+                if (collapsesAway)
+                {
+                    removed++;
+                    continue;
+                }
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            collapseTo[collapse.from] = collapse.to;
+            quadrics[to].Add(quadrics[from]);
+            resultErrorSquared = std::max(resultErrorSquared, collapse.error);
+            triangles -= removed;
+            collapses++;
+
+            for (unsigned int t = adjacency.offsets[from]; t < adjacency.offsets[from + 1]; t++)
+            {
+                const unsigned int* triangle = &result[adjacency.triangles[t] * 3];
+                for (int k = 0; k < 3; k++)
+                    touched[position[triangle[k]]] = 1;
+            }
+        }
+        if (collapses == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = collapseTo[result[i]], b = collapseTo[result[i + 1]], c = collapseTo[result[i + 2]];
+            if (position[a] == position[b] || position[b] == position[c] || position[c] == position[a])
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    error = float(std::sqrt(resultErrorSquared));
+    return result;
+}
+
+void GenerateLods(MeshData& mesh)
+{
+    mesh.lods.clear();
+    if (mesh.indices.empty())
+        return;
+    mesh.lods.push_back({ 0, static_cast<unsigned int>(mesh.indices.size()), 0.0f });
+
+    glm::vec3 minimum = mesh.vertices[0].Position, maximum = minimum;
+    for (const Vertex& vertex : mesh.vertices)
+    {
+        minimum = glm::min(minimum, vertex.Position);
+        maximum = glm::max(maximum, vertex.Position);
+    }
+    const float extent = glm::length(maximum - minimum);
+    if (extent == 0.0f)
+        return;
+
+    // Each level is simplified from the one before, so errors add up.
+    std::vector<unsigned int> previous = mesh.indices;
+    float previousError = 0.0f;
+    for (size_t level = 1; level < MaxLodCount; level++)
+    {
+        size_t target = size_t(mesh.lods[0].indexCount * LodTriangleRatios[level - 1]) / 3 * 3;
+        float error = 0.0f;
+        std::vector<unsigned int> lod = SimplifyMesh(mesh.vertices, previous, target, LodRelativeErrors[level - 1] * extent, error);
+        if (lod.empty() || lod.size() > previous.size() * MinimumLodReduction)
+            break;
+
+        OptimizeVertexCache(lod, mesh.vertices.size());
+        MeshLod entry = { static_cast<unsigned int>(mesh.indices.size()), static_cast<unsigned int>(lod.size()), previousError + error };
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        mesh.lods.push_back(entry);
+
+        previous.swap(lod);
+        previousError = entry.error;
+    }
+}
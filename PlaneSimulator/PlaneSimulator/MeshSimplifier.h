@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Mesh.h"
+
+// Import-time level-of-detail generation by quadric error edge collapse
+// (Garland and Heckbert). Vertices only ever collapse onto existing ones, so
+// every level indexes the same vertex buffer and a LOD is just another index
+// range. Vertices on UV seams and open borders are locked so textures and
+// silhouettes hold together; normals are ignored when matching vertices, so
+// flat shaded models still simplify.
+
+// Levels GenerateLods builds at most, including the full-detail one.
+const size_t MaxLodCount = 4;
+
+// Collapses edges until at most targetIndexCount indices are left or the next
+// collapse would move the surface by more than maxError (model units). error
+// receives the largest deviation actually introduced.
+std::vector<unsigned int> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices,
+    size_t targetIndexCount, float maxError, float& error);
+
+// Appends successively coarser copies of mesh.indices (each about half the
+// previous one) and records every level, the original first, in mesh.lods.
+// Stops early once the mesh no longer simplifies within the error budget.
+void GenerateLods(MeshData& mesh);
@@ -0,0 +1,124 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Below this the cone is too wide for the test to reject anything reliably.
+    const float MinimumConeSpread = 0.1f;
+
+    void finishMeshlet(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, Meshlet& meshlet)
+    {
+        const unsigned int* triangles = &indices[meshlet.indexOffset];
+
+        glm::vec3 minimum = vertices[triangles[0]].Position, maximum = minimum;
+        for (unsigned int i = 0; i < meshlet.indexCount; i++)
+        {
+            minimum = glm::min(minimum, vertices[triangles[i]].Position);
+            maximum = glm::max(maximum, vertices[triangles[i]].Position);
+        }
+        meshlet.center = (minimum + maximum) * 0.5f;
+        meshlet.radius = 0.0f;
+        for (unsigned int i = 0; i < meshlet.indexCount; i++)
+            meshlet.radius = std::max(meshlet.radius, glm::distance(meshlet.center, vertices[triangles[i]].Position));
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.indexCount / 3);
+        glm::vec3 axis(0.0f);
+        for (unsigned int i = 0; i < meshlet.indexCount; i += 3)
+        {
+            const glm::vec3& p0 = vertices[triangles[i]].Position;
+            glm::vec3 normal = glm::cross(vertices[triangles[i + 1]].Position - p0, vertices[triangles[i + 2]].Position - p0);
+            float length = glm::length(normal);
+            if (length == 0.0f)
+                continue;
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+        float axisLength = glm::length(axis);
+        if (normals.empty() || axisLength == 0.0f)
+            return;
+        meshlet.coneAxis = axis / axisLength;
+
+        float minimumDot = 1.0f;
+        for (const glm::vec3& normal : normals)
+            minimumDot = std::min(minimumDot, glm::dot(normal, meshlet.coneAxis));
+        if (minimumDot > MinimumConeSpread)
+            meshlet.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+    }
+}
+
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t indexCount)
+{
+    std::vector<Meshlet> meshlets;
+    if (indexCount / 3 < MinMeshletTriangles)
+        return meshlets;
+
+    // lastMeshlet[v] is the meshlet v was last counted in, so membership checks need no set.
+    std::vector<unsigned int> lastMeshlet(vertices.size(), ~0u);
+    Meshlet current = {};
+    size_t currentVertices = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const unsigned int meshletIndex = static_cast<unsigned int>(meshlets.size());
+        size_t newVertices = 0;
+        for (int k = 0; k < 3; k++)
+            newVertices += lastMeshlet[indices[i + k]] != meshletIndex;
+
+        if (currentVertices + newVertices > MaxMeshletVertices || current.indexCount / 3 + 1 > MaxMeshletTriangles)
+        {
+            finishMeshlet(vertices, indices, current);
+            meshlets.push_back(current);
+            current = {};
+            current.indexOffset = static_cast<unsigned int>(i);
+            currentVertices = 0;
+        }
+
+        const unsigned int target = static_cast<unsigned int>(meshlets.size());
+        for (int k = 0; k < 3; k++)
+        {
+            if (lastMeshlet[indices[i + k]] != target)
+            {
+                lastMeshlet[indices[i + k]] = target;
+                currentVertices++;
+            }
+        }
+        current.indexCount += 3;
+    }
+    if (current.indexCount > 0)
+    {
+        finishMeshlet(vertices, indices, current);
+        meshlets.push_back(current);
+    }
+    return meshlets;
+}
+
+MeshletCullView MeshletCullView::FromMatrices(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, bool backfaceCullingEnabled)
+{
+    MeshletCullView cullView;
+    cullView.frustum = Frustum::FromMatrix(projection * view * model);
+    cullView.cameraPosition = glm::vec3(glm::inverse(view * model)[3]);
+    // The cone test assumes rays from a point; an orthographic camera has none.
+    cullView.cullBackfaces = backfaceCullingEnabled && projection[3][3] == 0.0f;
+    return cullView;
+}
+
+bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullView& view)
+{
+    if (!view.frustum.IntersectsSphere(meshlet.center, meshlet.radius))
+        return false;
+
+    // Back-facing if the camera sits behind every triangle's plane; with the
+    // apex at the cluster's centre the sphere radius keeps the test conservative.
+    if (view.cullBackfaces && meshlet.coneCutoff < 1.0f)
+    {
+        glm::vec3 toCluster = meshlet.center - view.cameraPosition;
+        if (glm::dot(toCluster, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCluster) + meshlet.radius)
+            return false;
+    }
+    return true;
+}
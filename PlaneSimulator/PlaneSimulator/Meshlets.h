@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Frustum.h"
+#include "Mesh.h"
+
+// Import-time split of a mesh's full-detail triangles into small clusters
+// that can be culled on the CPU, so a large mesh that is only partly on
+// screen submits only the visible part of its index buffer.
+
+const size_t MaxMeshletVertices = 64;
+const size_t MaxMeshletTriangles = 124;
+// Meshes with fewer triangles are drawn whole; culling would cost more than it saves.
+const size_t MinMeshletTriangles = 4 * MaxMeshletTriangles;
+
+// Cuts the first indexCount indices into consecutive clusters of at most
+// MaxMeshletVertices vertices and MaxMeshletTriangles triangles. Triangles
+// keep their order, so the vertex cache optimization survives and each
+// cluster is one contiguous index range.
+std::vector<Meshlet> BuildMeshlets(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, size_t indexCount);
+
+// Camera of one draw, brought into the mesh's model space.
+struct MeshletCullView
+{
+    Frustum frustum;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    // Back-facing clusters are only culled for perspective views with GL_CULL_FACE on.
+    bool cullBackfaces = false;
+
+    static MeshletCullView FromMatrices(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, bool backfaceCullingEnabled);
+};
+
+bool IsMeshletVisible(const Meshlet& meshlet, const MeshletCullView& view);
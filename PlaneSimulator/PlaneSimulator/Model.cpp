@@ -1,21 +1,270 @@
 #include "Model.h"
 
-void Model::loadModel(std::string path)
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+namespace
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    double elapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void collectTexturePaths(const std::vector<TextureRef>& textures, std::vector<std::string>& paths)
+    {
+        for (const TextureRef& ref : textures)
+        {
+            if (std::find(paths.begin(), paths.end(), ref.path) == paths.end())
+                paths.push_back(ref.path);
+        }
+    }
+
+    void optimizeMeshes(const std::string& path, std::vector<MeshData>& meshes, bool printReport)
+    {
+        // Built up front and printed in one go, since imports run on several threads.
+        std::ostringstream report;
+        report << "Optimized " << path.substr(path.find_last_of("\\/") + 1) << std::endl << std::fixed << std::setprecision(3);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            MeshOptimizationStats stats = OptimizeMesh(meshes[i]);
+            report << "  mesh " << i << ": " << stats.triangles << " tris, "
+                << stats.verticesBefore << " -> " << stats.verticesAfter << " verts, ACMR "
+                << stats.before.acmr << " -> " << stats.after.acmr << ", ATVR "
+                << stats.before.atvr << " -> " << stats.after.atvr << std::endl;
+        }
+        if (printReport)
+            std::cout << report.str();
+    }
+
+    void generateLods(const std::string& path, std::vector<MeshData>& meshes, bool printReport)
+    {
+        std::ostringstream report;
+        report << "LODs " << path.substr(path.find_last_of("\\/") + 1) << std::endl << std::fixed << std::setprecision(4);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            GenerateLods(meshes[i]);
+            report << "  mesh " << i << ":";
+            for (const MeshLod& lod : meshes[i].lods)
+                report << " " << lod.indexCount / 3 << " tris (" << lod.error << ")";
+            report << std::endl;
+        }
+        if (printReport)
+            std::cout << report.str();
+    }
+
+    // Largest projected error, in pixels, a level may have to be drawn.
+    const float LodPixelError = 1.0f;
+    // A coarser level than last frame's must fit this fraction of LodPixelError.
+    const float LodHysteresis = 0.75f;
+}
+
+Model::~Model()
+{
+    Release();
+}
+
+Model::Model(Model&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+Model& Model::operator=(Model&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        meshes = std::move(other.meshes);
+        directory = std::move(other.directory);
+        textures_loaded = std::move(other.textures_loaded);
+        boundsCenter = other.boundsCenter;
+        boundsRadius = other.boundsRadius;
+        lodErrors = std::move(other.lodErrors);
+        other.meshes.clear();
+        other.textures_loaded.clear();
+        other.lodErrors.clear();
+    }
+    return *this;
+}
+
+ModelData Model::Import(const std::string& path, const ModelLoadOptions& options)
+{
+    Clock::time_point start = Clock::now();
+
+    ModelData data;
+    data.path = path;
+    data.directory = path.substr(0, path.find_last_of('\\'));
+
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    bool useObjImporter = options.useObjImporter && extension == "obj";
+
+    uint64_t sourceHash = options.useMeshCache ? MeshCache::HashSource(path) : 0;
+    // Imports that build different meshes from the same file each keep their own cache file, so
+    // loading one variant does not evict another. Only .obj files have two importers to choose from.
+    uint32_t cacheVariant = (options.optimizeMeshes ? 0 : 1) | (extension == "obj" && !useObjImporter ? 2 : 0) |
+        (options.generateLods ? 0 : 4) | (options.buildMeshlets ? 0 : 8);
+    if (sourceHash != 0)
+    {
+        std::unique_ptr<MeshCache> cache(new MeshCache());
+        if (cache->Open(path, cacheVariant, sourceHash))
+            data.cache = std::move(cache);
+    }
+
+    if (!data.cache)
+    {
+        if (!useObjImporter || !ImportObj(path, data.meshes))
+        {
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
+
+            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+            {
+                std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+                return data;
+            }
+
+            processNode(scene->mRootNode, scene, data.meshes);
+        }
+        if (options.optimizeMeshes)
+            optimizeMeshes(path, data.meshes, options.printMeshReports);
+        if (options.generateLods)
+            generateLods(path, data.meshes, options.printMeshReports);
+        if (options.buildMeshlets)
+        {
+            for (MeshData& mesh : data.meshes)
+                mesh.meshlets = BuildMeshlets(mesh.vertices, mesh.indices, mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount);
+        }
+
+        if (sourceHash != 0)
+            MeshCache::Write(path, cacheVariant, sourceHash, data.meshes);
+    }
+    data.importMs = elapsedMs(start);
+
+    data.packVertices = options.packVertices;
+    data.keepCpuData = options.keepCpuData;
+    data.streamTextures = options.streamTextures;
+    if (data.streamTextures)
+        return data;
+
+    start = Clock::now();
+    std::vector<std::string> texturePaths;
+    if (data.cache)
+    {
+        for (size_t i = 0; i < data.cache->MeshCount(); i++)
+            collectTexturePaths(data.cache->GetMesh(i).textures, texturePaths);
+    }
+    for (const MeshData& mesh : data.meshes)
+        collectTexturePaths(mesh.textures, texturePaths);
+
+    for (const std::string& texturePath : texturePaths)
+    {
+        ImageData image;
+        image.Load(data.directory + '\\' + texturePath);
+        data.images.emplace(texturePath, std::move(image));
+    }
+    data.decodeMs = elapsedMs(start);
+
+    return data;
+}
+
+void Model::upload(ModelData& data)
 {
-    Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals);
+    directory = data.directory;
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+    if (data.cache)
     {
-        std::cout << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        meshes.reserve(data.cache->MeshCount());
+        for (size_t i = 0; i < data.cache->MeshCount(); i++)
+        {
+            const CachedMesh& cached = data.cache->GetMesh(i);
+
+            std::vector<Texture> textures;
+            for (const TextureRef& ref : cached.textures)
+                textures.push_back(loadTexture(ref.path, ref.type, data));
+
+            meshes.emplace_back(cached.vertices, cached.vertexCount, cached.indices, cached.indexCount, std::move(textures),
+                data.packVertices, data.keepCpuData);
+            meshes.back().SetLods(cached.lods);
+            meshes.back().SetMeshlets(cached.meshlets);
+        }
+        updateBounds();
         return;
     }
-    directory = path.substr(0, path.find_last_of('\\'));
 
-    processNode(scene->mRootNode, scene);
+    meshes.reserve(data.meshes.size());
+    for (MeshData& mesh : data.meshes)
+    {
+        std::vector<Texture> textures;
+        for (const TextureRef& ref : mesh.textures)
+            textures.push_back(loadTexture(ref.path, ref.type, data));
+
+        meshes.emplace_back(std::move(mesh.vertices), std::move(mesh.indices), std::move(textures), data.packVertices, data.keepCpuData);
+        meshes.back().SetLods(mesh.lods);
+        meshes.back().SetMeshlets(std::move(mesh.meshlets));
+    }
+    updateBounds();
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene)
+void Model::updateBounds()
+{
+    lodErrors.clear();
+    if (meshes.empty())
+        return;
+
+    glm::vec3 minimum(std::numeric_limits<float>::max()), maximum(-std::numeric_limits<float>::max());
+    for (const Mesh& mesh : meshes)
+    {
+        minimum = glm::min(minimum, mesh.BoundsCenter() - glm::vec3(mesh.BoundsRadius()));
+        maximum = glm::max(maximum, mesh.BoundsCenter() + glm::vec3(mesh.BoundsRadius()));
+    }
+    boundsCenter = (minimum + maximum) * 0.5f;
+    boundsRadius = 0.0f;
+    for (const Mesh& mesh : meshes)
+        boundsRadius = std::max(boundsRadius, glm::distance(boundsCenter, mesh.BoundsCenter()) + mesh.BoundsRadius());
+
+    // All meshes switch together, so a level is as coarse as its worst mesh.
+    size_t levels = 0;
+    for (const Mesh& mesh : meshes)
+        levels = std::max(levels, mesh.LodCount());
+    lodErrors.assign(levels, 0.0f);
+    for (const Mesh& mesh : meshes)
+    {
+        for (size_t lod = 0; lod < levels; lod++)
+            lodErrors[lod] = std::max(lodErrors[lod], mesh.LodError(lod));
+    }
+}
+
+int Model::SelectLod(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight, int previousLod) const
+{
+    if (lodErrors.size() < 2)
+        return 0;
+
+    glm::vec4 center = view * model * glm::vec4(boundsCenter, 1.0f);
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    // Clip w of the centre: its view depth under a perspective projection, 1 under an orthographic one.
+    float w = projection[2][3] * center.z + projection[3][3];
+    bool perspective = projection[3][3] == 0.0f;
+    if (perspective && w <= boundsRadius * scale)
+        return 0;
+
+    float pixelsPerUnit = projection[1][1] * 0.5f * viewportHeight / w;
+    for (int lod = int(lodErrors.size()) - 1; lod > 0; lod--)
+    {
+        float pixels = lodErrors[lod] * scale * pixelsPerUnit;
+        float limit = lod > previousLod ? LodPixelError * LodHysteresis : LodPixelError;
+        if (pixels <= limit)
+            return lod;
+    }
+    return 0;
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes)
 {
     for (unsigned int i = 0; i < node->mNumMeshes; i++)
     {
@@ -24,19 +273,24 @@ void Model::processNode(aiNode* node, const aiScene* scene)
     }
     for (unsigned int i = 0; i < node->mNumChildren; i++)
     {
-        processNode(node->mChildren[i], scene);
+        processNode(node->mChildren[i], scene, meshes);
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
+MeshData Model::processMesh(aiMesh* mesh, const aiScene* scene)
 {
-    std::vector<Vertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    MeshData data;
+    std::vector<Vertex>& vertices = data.vertices;
+    std::vector<unsigned int>& indices = data.indices;
+    std::vector<TextureRef>& textures = data.textures;
+
+    vertices.reserve(mesh->mNumVertices);
+    indices.reserve(mesh->mNumFaces * 3);
 
     for (unsigned int i = 0; i < mesh->mNumVertices; i++)
     {
-        Vertex vertex;
+        // Tangents are not filled in here; zero them so welding and the mesh cache see defined bytes.
+        Vertex vertex = {};
         glm::vec3 vector;
         vector.x = mesh->mVertices[i].x;
         vector.y = mesh->mVertices[i].y;
@@ -71,47 +325,103 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
     {
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         
-        std::vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
+        std::vector<TextureRef> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        std::vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
+        std::vector<TextureRef> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
         textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
     }
 
-    return Mesh(vertices, indices, textures);
+    return data;
 }
 
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
+std::vector<TextureRef> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
 {
-    std::vector<Texture> textures;
+    std::vector<TextureRef> textures;
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++)
     {
         aiString str;
         mat->GetTexture(type, i, &str);
-        bool skip = false;
-        for (unsigned int j = 0; j < textures_loaded.size(); j++)
-        {
-            if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-            {
-                textures.push_back(textures_loaded[j]);
-                skip = true;
-                break;
-            }
-        }
-        if (!skip)
-        {
-            Texture texture;
-            texture.id = TextureFromFile(str.C_Str(), this->directory);
-            texture.type = typeName;
-            texture.path = str.C_Str();
-            textures.push_back(texture);
-            textures_loaded.push_back(texture); 
-        }
+        TextureRef ref;
+        ref.type = typeName;
+        ref.path = str.C_Str();
+        textures.push_back(ref);
     }
     return textures;
 }
 
-void Model::Draw(Shader& shader)
+Texture Model::loadTexture(const std::string& path, const std::string& typeName, ModelData& data)
+{
+    const ImageData* decoded = nullptr;
+    if (!data.streamTextures)
+    {
+        auto image = data.images.find(path);
+        if (image != data.images.end())
+            decoded = &image->second;
+    }
+
+    Texture texture;
+    texture.id = TextureCache::Get().Acquire(this->directory + '\\' + path, TextureParams(), decoded);
+    texture.type = typeName;
+    texture.path = path;
+    textures_loaded.push_back(texture);
+    return texture;
+}
+
+unsigned int Model::TextureFromFile(const char* path, const std::string& directory, bool gamma)
+{
+    std::string filename = std::string(path);
+    filename = directory + '\\' + filename;
+
+    ImageData image;
+    if (!image.Load(filename))
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+
+    TextureParams params;
+    params.gamma = gamma;
+    return UploadTexture(image, params);
+}
+
+void Model::Draw(Shader& shader, int lod, const MeshletCullView* cull)
+{
+    // Meshes of one format share a VAO; GLState drops the bind until the format changes.
+    GeometryArena& arena = GeometryArena::Get();
+    for (unsigned int i = 0; i < meshes.size(); i++)
+    {
+        arena.Bind(meshes[i].Format());
+        meshes[i].DrawBound(shader, lod, cull);
+    }
+}
+
+void Model::DrawInstanced(Shader& shader, const InstanceBuffer& instances, size_t count, int lod)
 {
+    count = std::min(count, instances.Count());
+    if (count == 0)
+        return;
+
+    GeometryArena& arena = GeometryArena::Get();
     for (unsigned int i = 0; i < meshes.size(); i++)
-        meshes[i].Draw(shader);
+    {
+        arena.BindInstanced(meshes[i].Format(), instances.Buffer());
+        meshes[i].DrawInstancedBound(shader, count, lod);
+    }
+}
+
+size_t Model::GpuBytes() const
+{
+    size_t bytes = 0;
+    for (const Mesh& mesh : meshes)
+        bytes += mesh.GpuBytes();
+    return bytes;
+}
+
+void Model::Release()
+{
+    for (unsigned int i = 0; i < meshes.size(); i++)
+        meshes[i].Release();
+    meshes.clear();
+    lodErrors.clear();
+
+    for (unsigned int i = 0; i < textures_loaded.size(); i++)
+        TextureCache::Get().Release(textures_loaded[i].id);
+    textures_loaded.clear();
 }
\ No newline at end of file
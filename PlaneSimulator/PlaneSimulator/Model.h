@@ -4,11 +4,62 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <memory>
+#include <unordered_map>
 
+#include "InstanceBuffer.h"
 #include "Mesh.h"
-#include <stb_image.h>
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "ObjImporter.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+
+struct ModelLoadOptions
+{
+    // Read/write the binary mesh cache next to the source file instead of always running Assimp.
+    bool useMeshCache = true;
+    // Hand material textures to the TextureStreamer instead of decoding them during the import.
+    bool streamTextures = true;
+    // Weld and reorder freshly imported meshes (see MeshOptimizer.h) before they are cached.
+    bool optimizeMeshes = true;
+    // Upload meshes in the 16-byte PackedVertex layout; the model shaders decode both layouts.
+    bool packVertices = true;
+    // Keep Mesh::vertices/indices after the upload, for models that collision or picking reads.
+    bool keepCpuData = false;
+    // Parse .obj files with the multithreaded ObjImporter; other formats, and .obj files it rejects, still use Assimp.
+    bool useObjImporter = true;
+    // Build coarser levels of detail of every mesh (see MeshSimplifier.h) for Model::SelectLod.
+    bool generateLods = true;
+    // Split large meshes into cullable clusters (see Meshlets.h).
+    bool buildMeshlets = true;
+    // Print the per-mesh optimization and LOD statistics of fresh imports.
+    bool printMeshReports = false;
+};
 
+// Everything Model::Import produces off the GL thread.
+struct ModelData
+{
+    std::string path;
+    std::string directory;
+    // Fresh import; empty when the meshes come from a warm mesh cache instead.
+    std::vector<MeshData> meshes;
+    std::unique_ptr<MeshCache> cache;
+    // Decoded material textures keyed by the path the material references;
+    // empty when the textures are streamed in after the upload.
+    std::unordered_map<std::string, ImageData> images;
+    bool streamTextures = false;
+    bool packVertices = false;
+    bool keepCpuData = false;
+
+    double importMs = 0.0;
+    double decodeMs = 0.0;
+};
 
+// Owns its meshes and one TextureCache reference per texture; everything is
+// released with the model, so it can be moved but not copied.
 class Model
 {
 public:
@@ -17,58 +68,60 @@ public:
     std::string directory;
 
     Model() = default;
+    ~Model();
 
-    Model(std::string path)
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    Model(Model&& other) noexcept;
+    Model& operator=(Model&& other) noexcept;
+
+    Model(std::string path, const ModelLoadOptions& options = ModelLoadOptions())
     {
-        loadModel(path);
+        ModelData data = Import(path, options);
+        upload(data);
     }
-    void Draw(Shader& shader); // Render all meshes in the model
-
-    unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false)
+    // Uploads the result of Import; must run on the GL thread.
+    explicit Model(ModelData& data)
     {
-        std::string filename = std::string(path);
-        filename = directory + '\\' + filename;
-
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-
-        int width, height, nrComponents;
-        unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-        if (data)
-        {
-            GLenum format;
-            if (nrComponents == 1)
-                format = GL_RED;
-            else if (nrComponents == 3)
-                format = GL_RGB;
-            else if (nrComponents == 4)
-                format = GL_RGBA;
-
-            glBindTexture(GL_TEXTURE_2D, textureID);
-            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            glGenerateMipmap(GL_TEXTURE_2D);
-
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Texture failed to load at path: " << path << std::endl;
-            stbi_image_free(data);
-        }
-
-        return textureID;
+        upload(data);
     }
 
+    // CPU half of loading: parses the file (or maps its mesh cache) and decodes
+    // the referenced textures. Makes no GL calls, so it can run on any thread.
+    static ModelData Import(const std::string& path, const ModelLoadOptions& options = ModelLoadOptions());
+
+    void Draw(Shader& shader, int lod = 0, const MeshletCullView* cull = nullptr); // Render all meshes in the model
+    // Draws the first count transforms of instances with one call per mesh. The
+    // shader must be an instanced variant (terrain_instanced.vs, default_instanced.vs).
+    void DrawInstanced(Shader& shader, const InstanceBuffer& instances, size_t count, int lod = 0);
+    // Coarsest level whose simplification error projects to at most LodPixelError
+    // pixels for an instance drawn with these matrices. previousLod is the level the
+    // instance used last frame: coarsening needs a tighter fit than staying, so an
+    // instance near a threshold does not pop back and forth.
+    int SelectLod(const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection, float viewportHeight, int previousLod) const;
+    size_t LodCount() const { return lodErrors.size(); }
+    // Bounding sphere of all meshes in model space.
+    const glm::vec3& BoundsCenter() const { return boundsCenter; }
+    float BoundsRadius() const { return boundsRadius; }
+    void Release(); // Free the geometry and textures early; the destructor does it otherwise
+    size_t GpuBytes() const; // Vertex and index buffer memory of all meshes
+
+    unsigned int TextureFromFile(const char* path, const std::string& directory, bool gamma = false);
+
 private:
-    void loadModel(std::string path);
-    void processNode(aiNode* node, const aiScene* scene);
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene);
-    std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+    void upload(ModelData& data);
+    static void processNode(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshes);
+    static MeshData processMesh(aiMesh* mesh, const aiScene* scene);
+    static std::vector<TextureRef> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName);
+    Texture loadTexture(const std::string& path, const std::string& typeName, ModelData& data);
 
+    // One TextureCache reference per entry, returned by Release().
     std::vector<Texture> textures_loaded;
+
+    // Model-space bounding sphere of all meshes, and per level the largest error of any mesh.
+    glm::vec3 boundsCenter = glm::vec3(0.0f);
+    float boundsRadius = 0.0f;
+    std::vector<float> lodErrors;
+
+    void updateBounds();
 };
@@ -0,0 +1,71 @@
+#include "ModelCache.h"
+
+#include "Paths.h"
+
+ModelCache& ModelCache::Get()
+{
+    static ModelCache instance;
+    return instance;
+}
+
+std::string ModelCache::MakeKey(const std::string& path, const ModelLoadOptions& options)
+{
+    // useMeshCache and streamTextures only change how the model is loaded, not what is loaded.
+    std::string key = CanonicalPath(path);
+    key += '|';
+    key += options.optimizeMeshes ? 'o' : '-';
+    key += options.packVertices ? 'p' : '-';
+    key += options.keepCpuData ? 'k' : '-';
+    key += options.useObjImporter ? 'i' : '-';
+    key += options.generateLods ? 'l' : '-';
+    key += options.buildMeshlets ? 'm' : '-';
+    return key;
+}
+
+ModelHandle ModelCache::Load(const std::string& path, const ModelLoadOptions& options)
+{
+    if (ModelHandle existing = Find(path, options))
+        return existing;
+
+    // Importing can take seconds; other threads keep using the registry meanwhile.
+    return Adopt(path, options, new Model(path, options));
+}
+
+ModelHandle ModelCache::Find(const std::string& path, const ModelLoadOptions& options)
+{
+    const std::string key = MakeKey(path, options);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = models.find(key);
+    return it != models.end() ? it->second.lock() : ModelHandle();
+}
+
+ModelHandle ModelCache::Adopt(const std::string& path, const ModelLoadOptions& options, Model* model)
+{
+    const std::string key = MakeKey(path, options);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::weak_ptr<Model>& slot = models[key];
+    if (ModelHandle existing = slot.lock())
+    {
+        delete model;
+        return existing;
+    }
+
+    ModelHandle handle(model);
+    slot = handle;
+    return handle;
+}
+
+size_t ModelCache::LoadedCount()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = models.begin(); it != models.end();)
+    {
+        if (it->second.expired())
+            it = models.erase(it);
+        else
+            ++it;
+    }
+    return models.size();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Model.h"
+
+typedef std::shared_ptr<Model> ModelHandle;
+
+// Process-wide registry handing out shared handles to loaded models. Every
+// asset is imported and uploaded once per canonical path and set of options
+// that change the result (see MakeKey); its GL buffers and textures are
+// released when the last handle goes away.
+class ModelCache
+{
+public:
+    static ModelCache& Get();
+
+    // Registry key: the canonical path plus the options that change what is loaded.
+    static std::string MakeKey(const std::string& path, const ModelLoadOptions& options);
+
+    // Returns the live model for path and options, loading it on first use. The
+    // import runs outside the registry lock; if another thread registers the
+    // same model meanwhile, that one is returned and this copy released.
+    ModelHandle Load(const std::string& path, const ModelLoadOptions& options = ModelLoadOptions());
+    // Returns the live model for path and options, or an empty handle.
+    ModelHandle Find(const std::string& path, const ModelLoadOptions& options = ModelLoadOptions());
+    // Registers a model loaded with options elsewhere (e.g. by the AssetLoader)
+    // and takes ownership of it. If it is already live, model is released and
+    // the existing handle returned instead.
+    ModelHandle Adopt(const std::string& path, const ModelLoadOptions& options, Model* model);
+
+    // Number of distinct models currently alive.
+    size_t LoadedCount();
+
+private:
+    ModelCache() = default;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::weak_ptr<Model>> models;
+};
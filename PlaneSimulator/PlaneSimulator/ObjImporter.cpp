@@ -0,0 +1,533 @@
+#include "ObjImporter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+#include "MTLLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    double elapsedMs(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Smaller files are not worth splitting; larger ones get a few chunks per
+    // thread so one slow chunk does not hold up the rest.
+    const size_t MinimumChunkBytes = 256 * 1024;
+    const size_t ChunksPerThread = 4;
+
+    const int NoIndex = -1;
+
+    // Corner::relative bits: the index was negative and counts back from the
+    // end of this chunk's own data, so the chunk's base still has to be added.
+    const unsigned char RelativePosition = 1;
+    const unsigned char RelativeTexCoord = 2;
+    const unsigned char RelativeNormal = 4;
+
+    // One face corner as 0-based indices into the whole file's v/vt/vn arrays.
+    struct Corner
+    {
+        int position;
+        int texCoord;
+        int normal;
+        unsigned char relative;
+    };
+
+    // A usemtl, o or g statement.
+    struct GroupSwitch
+    {
+        // First corner of this chunk the new material or object applies to.
+        size_t corner;
+        // o and g name an object; usemtl names a material.
+        bool object;
+        std::string name;
+    };
+
+    struct Chunk
+    {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+        // Three per triangle.
+        std::vector<Corner> corners;
+        std::vector<GroupSwitch> switches;
+        std::vector<std::string> libraries;
+
+        // Scratch for the face being triangulated.
+        std::vector<Corner> polygon;
+    };
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    const char* skipSpace(const char* p, const char* end)
+    {
+        while (p < end && isSpace(*p))
+            p++;
+        return p;
+    }
+
+    bool parseFloat(const char*& p, const char* end, float& value)
+    {
+        p = skipSpace(p, end);
+        // from_chars rejects an explicit plus sign.
+        if (p < end && *p == '+')
+            p++;
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        return true;
+    }
+
+    // Reads up to count floats, stopping at the first token that is not a number.
+    int parseFloats(const char*& p, const char* end, float* values, int count)
+    {
+        int read = 0;
+        while (read < count && parseFloat(p, end, values[read]))
+            read++;
+        return read;
+    }
+
+    // Rest of the line with surrounding whitespace trimmed.
+    std::string parseRest(const char* p, const char* end)
+    {
+        p = skipSpace(p, end);
+        while (end > p && isSpace(end[-1]))
+            end--;
+        return std::string(p, end);
+    }
+
+    // OBJ indices are 1-based, or negative to count back from the last element so far; 0 means absent.
+    int resolveIndex(int value, size_t count, unsigned char flag, unsigned char& relative)
+    {
+        if (value > 0)
+            return value - 1;
+        if (value < 0)
+        {
+            relative |= flag;
+            return int(count) + value;
+        }
+        return NoIndex;
+    }
+
+    // "v", "v/vt", "v//vn" or "v/vt/vn".
+    bool parseCorner(const char*& p, const char* end, const Chunk& chunk, Corner& corner)
+    {
+        corner.texCoord = NoIndex;
+        corner.normal = NoIndex;
+        corner.relative = 0;
+
+        int value = 0;
+        std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc())
+            return false;
+        p = result.ptr;
+        corner.position = resolveIndex(value, chunk.positions.size(), RelativePosition, corner.relative);
+
+        if (p < end && *p == '/')
+        {
+            p++;
+            result = std::from_chars(p, end, value);
+            if (result.ec == std::errc())
+            {
+                p = result.ptr;
+                corner.texCoord = resolveIndex(value, chunk.texCoords.size(), RelativeTexCoord, corner.relative);
+            }
+            if (p < end && *p == '/')
+            {
+                p++;
+                result = std::from_chars(p, end, value);
+                if (result.ec == std::errc())
+                {
+                    p = result.ptr;
+                    corner.normal = resolveIndex(value, chunk.normals.size(), RelativeNormal, corner.relative);
+                }
+            }
+        }
+        // Skip anything malformed up to the next corner.
+        while (p < end && !isSpace(*p))
+            p++;
+        return true;
+    }
+
+    void parseFace(const char* p, const char* end, Chunk& chunk)
+    {
+        chunk.polygon.clear();
+        for (;;)
+        {
+            p = skipSpace(p, end);
+            Corner corner;
+            if (p == end || !parseCorner(p, end, chunk, corner))
+                break;
+            chunk.polygon.push_back(corner);
+        }
+
+        // Fan triangulation, as aiProcess_Triangulate does for convex polygons.
+        for (size_t i = 2; i < chunk.polygon.size(); i++)
+        {
+            chunk.corners.push_back(chunk.polygon[0]);
+            chunk.corners.push_back(chunk.polygon[i - 1]);
+            chunk.corners.push_back(chunk.polygon[i]);
+        }
+    }
+
+    bool startsWith(const char* p, const char* end, const char* keyword, size_t length)
+    {
+        return size_t(end - p) > length && std::memcmp(p, keyword, length) == 0 && isSpace(p[length]);
+    }
+
+    void parseChunk(Chunk& chunk)
+    {
+        const char* p = chunk.begin;
+        while (p < chunk.end)
+        {
+            const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', chunk.end - p));
+            if (!lineEnd)
+                lineEnd = chunk.end;
+            const char* line = skipSpace(p, lineEnd);
+            p = lineEnd + 1;
+
+            if (lineEnd - line < 2)
+                continue;
+
+            if (line[0] == 'v')
+            {
+                float values[3] = { 0.0f, 0.0f, 0.0f };
+                if (isSpace(line[1]))
+                {
+                    line += 2;
+                    parseFloats(line, lineEnd, values, 3);
+                    chunk.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+                }
+                else if (line[1] == 't' && startsWith(line, lineEnd, "vt", 2))
+                {
+                    line += 3;
+                    parseFloats(line, lineEnd, values, 2);
+                    chunk.texCoords.push_back(glm::vec2(values[0], values[1]));
+                }
+                else if (line[1] == 'n' && startsWith(line, lineEnd, "vn", 2))
+                {
+                    line += 3;
+                    parseFloats(line, lineEnd, values, 3);
+                    chunk.normals.push_back(glm::vec3(values[0], values[1], values[2]));
+                }
+            }
+            else if (line[0] == 'f' && isSpace(line[1]))
+                parseFace(line + 2, lineEnd, chunk);
+            else if (startsWith(line, lineEnd, "usemtl", 6))
+            {
+                GroupSwitch groupSwitch = { chunk.corners.size(), false, parseRest(line + 6, lineEnd) };
+                chunk.switches.push_back(std::move(groupSwitch));
+            }
+            else if ((line[0] == 'o' || line[0] == 'g') && isSpace(line[1]))
+            {
+                GroupSwitch groupSwitch = { chunk.corners.size(), true, parseRest(line + 2, lineEnd) };
+                chunk.switches.push_back(std::move(groupSwitch));
+            }
+            else if (startsWith(line, lineEnd, "mtllib", 6))
+            {
+                // One statement may name several libraries, separated by whitespace.
+                const char* name = skipSpace(line + 6, lineEnd);
+                while (name < lineEnd)
+                {
+                    const char* nameEnd = name;
+                    while (nameEnd < lineEnd && !isSpace(*nameEnd))
+                        nameEnd++;
+                    chunk.libraries.emplace_back(name, nameEnd);
+                    name = skipSpace(nameEnd, lineEnd);
+                }
+            }
+        }
+    }
+
+    // Cuts [text, text + size) into count pieces, each ending just after a newline.
+    std::vector<Chunk> splitChunks(const char* text, size_t size, size_t count)
+    {
+        std::vector<Chunk> chunks(count);
+        const char* begin = text;
+        const char* end = text + size;
+        for (size_t i = 0; i < count; i++)
+        {
+            const char* split = i + 1 == count ? end : std::max(begin, text + size * (i + 1) / count);
+            if (split < end)
+            {
+                const char* newline = static_cast<const char*>(std::memchr(split, '\n', end - split));
+                split = newline ? newline + 1 : end;
+            }
+            chunks[i].begin = begin;
+            chunks[i].end = split;
+            begin = split;
+        }
+        return chunks;
+    }
+
+    // A run of one chunk's corners that all belong to the same object and material.
+    struct Span
+    {
+        const Chunk* chunk;
+        size_t begin;
+        size_t end;
+    };
+
+    struct MaterialGroup
+    {
+        std::string material;
+        std::vector<Span> spans;
+        size_t corners = 0;
+    };
+
+    struct CornerKey
+    {
+        int position;
+        int texCoord;
+        int normal;
+
+        bool operator==(const CornerKey& other) const
+        {
+            return position == other.position && texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+
+    struct CornerKeyHash
+    {
+        size_t operator()(const CornerKey& key) const
+        {
+            size_t hash = size_t(unsigned(key.position)) * 0x9E3779B1u;
+            hash ^= size_t(unsigned(key.texCoord)) * 0x85EBCA77u + (hash << 6) + (hash >> 2);
+            hash ^= size_t(unsigned(key.normal)) * 0xC2B2AE3Du + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+
+    struct Attributes
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> texCoords;
+        std::vector<glm::vec3> normals;
+    };
+
+    bool inRange(int index, size_t count)
+    {
+        return index >= 0 && size_t(index) < count;
+    }
+
+    void buildMesh(const MaterialGroup& group, const Attributes& attributes, const MaterialLibrary& library, MeshData& mesh)
+    {
+        std::unordered_map<CornerKey, unsigned int, CornerKeyHash> lookup;
+        lookup.reserve(group.corners);
+        mesh.indices.reserve(group.corners);
+
+        int triangle = 0;
+        for (const Span& span : group.spans)
+        {
+            for (size_t c = span.begin; c + 3 <= span.end; c += 3, triangle++)
+            {
+                const Corner* corners = &span.chunk->corners[c];
+                if (!inRange(corners[0].position, attributes.positions.size()) ||
+                    !inRange(corners[1].position, attributes.positions.size()) ||
+                    !inRange(corners[2].position, attributes.positions.size()))
+                    continue;
+
+                glm::vec3 faceNormal(0.0f);
+                for (int k = 0; k < 3; k++)
+                {
+                    if (inRange(corners[k].normal, attributes.normals.size()))
+                        continue;
+                    const glm::vec3& p0 = attributes.positions[corners[0].position];
+                    glm::vec3 normal = glm::cross(attributes.positions[corners[1].position] - p0, attributes.positions[corners[2].position] - p0);
+                    float length = glm::length(normal);
+                    if (length > 0.0f)
+                        faceNormal = normal / length;
+                    break;
+                }
+
+                for (int k = 0; k < 3; k++)
+                {
+                    const Corner& corner = corners[k];
+                    bool hasTexCoord = inRange(corner.texCoord, attributes.texCoords.size());
+                    bool hasNormal = inRange(corner.normal, attributes.normals.size());
+
+                    // Face normals are per triangle, so those corners only merge within it.
+                    CornerKey key = { corner.position, hasTexCoord ? corner.texCoord : NoIndex, hasNormal ? corner.normal : -2 - triangle };
+                    auto inserted = lookup.emplace(key, static_cast<unsigned int>(mesh.vertices.size()));
+                    if (inserted.second)
+                    {
+                        Vertex vertex = {};
+                        vertex.Position = attributes.positions[corner.position];
+                        vertex.Normal = hasNormal ? attributes.normals[corner.normal] : faceNormal;
+                        if (hasTexCoord)
+                        {
+                            const glm::vec2& texCoord = attributes.texCoords[corner.texCoord];
+                            vertex.TexCoords = glm::vec2(texCoord.x, 1.0f - texCoord.y);
+                        }
+                        mesh.vertices.push_back(vertex);
+                    }
+                    mesh.indices.push_back(inserted.first->second);
+                }
+            }
+        }
+
+        const Material* material = library.Find(group.material);
+        if (material)
+        {
+            if (material->diffuseMap.IsSet())
+                mesh.textures.push_back({ "texture_diffuse", material->diffuseMap.path });
+            if (material->specularMap.IsSet())
+                mesh.textures.push_back({ "texture_specular", material->specularMap.path });
+        }
+    }
+}
+
+bool ImportObj(const std::string& path, std::vector<MeshData>& meshes, ObjImportStats* stats)
+{
+    Clock::time_point start = Clock::now();
+
+    MappedFile file(path);
+    if (!file.IsOpen())
+    {
+        std::cout << "ERROR::OBJ::Failed to open " << path << std::endl;
+        return false;
+    }
+    const char* text = reinterpret_cast<const char*>(file.Data());
+    size_t size = file.Size();
+
+    ThreadPool& pool = ThreadPool::Shared();
+    size_t chunkCount = std::min<size_t>(size / MinimumChunkBytes, (pool.ThreadCount() + 1) * ChunksPerThread);
+    std::vector<Chunk> chunks = splitChunks(text, size, std::max<size_t>(chunkCount, 1));
+    pool.ParallelFor(chunks.size(), [&chunks](size_t i)
+    {
+        parseChunk(chunks[i]);
+    });
+    double parseMs = elapsedMs(start);
+
+    // Concatenate the attributes and turn chunk-relative indices into file ones.
+    start = Clock::now();
+    Attributes attributes;
+    std::vector<size_t> positionBase(chunks.size()), texCoordBase(chunks.size()), normalBase(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        positionBase[i] = attributes.positions.size();
+        texCoordBase[i] = attributes.texCoords.size();
+        normalBase[i] = attributes.normals.size();
+        attributes.positions.insert(attributes.positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+        attributes.texCoords.insert(attributes.texCoords.end(), chunks[i].texCoords.begin(), chunks[i].texCoords.end());
+        attributes.normals.insert(attributes.normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+    }
+    pool.ParallelFor(chunks.size(), [&](size_t i)
+    {
+        for (Corner& corner : chunks[i].corners)
+        {
+            if (!corner.relative)
+                continue;
+            if (corner.relative & RelativePosition)
+                corner.position += int(positionBase[i]);
+            if (corner.relative & RelativeTexCoord)
+                corner.texCoord += int(texCoordBase[i]);
+            if (corner.relative & RelativeNormal)
+                corner.normal += int(normalBase[i]);
+        }
+    });
+
+    // One mesh per object (o or g) and material in order of first use, as Assimp splits
+    // them; faces before any o, g or usemtl belong to the unnamed defaults.
+    MaterialLibrary library;
+    std::string directory = path.substr(0, path.find_last_of("\\/") + 1);
+    std::vector<std::string> loadedLibraries;
+    std::vector<MaterialGroup> groups;
+    std::unordered_map<std::string, size_t> groupByKey;
+    std::string currentObject, currentMaterial;
+    size_t currentGroup = 0;
+    // Cleared by every switch; the group is looked up once a face needs it.
+    bool haveGroup = false;
+    auto addSpan = [&](const Chunk& chunk, size_t begin, size_t end)
+    {
+        if (begin == end)
+            return;
+        if (!haveGroup)
+        {
+            const std::string key = currentObject + '\n' + currentMaterial;
+            auto existing = groupByKey.find(key);
+            if (existing == groupByKey.end())
+            {
+                existing = groupByKey.emplace(key, groups.size()).first;
+                groups.emplace_back();
+                groups.back().material = currentMaterial;
+            }
+            currentGroup = existing->second;
+            haveGroup = true;
+        }
+        groups[currentGroup].spans.push_back({ &chunk, begin, end });
+        groups[currentGroup].corners += end - begin;
+    };
+
+    for (const Chunk& chunk : chunks)
+    {
+        for (const std::string& name : chunk.libraries)
+        {
+            if (std::find(loadedLibraries.begin(), loadedLibraries.end(), name) != loadedLibraries.end())
+                continue;
+            loadedLibraries.push_back(name);
+            library.Load(directory + name);
+        }
+
+        size_t cursor = 0;
+        for (const GroupSwitch& groupSwitch : chunk.switches)
+        {
+            addSpan(chunk, cursor, groupSwitch.corner);
+            cursor = groupSwitch.corner;
+
+            if (groupSwitch.object)
+                currentObject = groupSwitch.name;
+            else
+                currentMaterial = groupSwitch.name;
+            haveGroup = false;
+        }
+        addSpan(chunk, cursor, chunk.corners.size());
+    }
+
+    // Materials that were selected but never given a face make no mesh.
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [](const MaterialGroup& group) { return group.corners == 0; }), groups.end());
+    if (groups.empty())
+    {
+        std::cout << "ERROR::OBJ::No faces in " << path << std::endl;
+        return false;
+    }
+
+    size_t firstMesh = meshes.size();
+    meshes.resize(firstMesh + groups.size());
+    pool.ParallelFor(groups.size(), [&](size_t i)
+    {
+        buildMesh(groups[i], attributes, library, meshes[firstMesh + i]);
+    });
+
+    if (stats)
+    {
+        stats->bytes = size;
+        stats->chunks = chunks.size();
+        stats->triangles = 0;
+        stats->vertices = 0;
+        for (size_t i = firstMesh; i < meshes.size(); i++)
+        {
+            stats->triangles += meshes[i].indices.size() / 3;
+            stats->vertices += meshes[i].vertices.size();
+        }
+        stats->parseMs = parseMs;
+        stats->buildMs = elapsedMs(start);
+    }
+    return true;
+}
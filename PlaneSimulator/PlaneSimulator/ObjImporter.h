@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+
+struct ObjImportStats
+{
+    size_t bytes = 0;
+    size_t chunks = 0;
+    size_t triangles = 0;
+    size_t vertices = 0;
+    double parseMs = 0.0;
+    double buildMs = 0.0;
+};
+
+// Wavefront .obj importer that bypasses Assimp. The mapped file is cut into
+// line-aligned chunks that are parsed in parallel on the shared ThreadPool,
+// then the faces of every object (o or g) and material become one mesh with
+// its v/vt/vn corners deduplicated. The result matches what Model::processMesh builds from
+// Assimp's aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals:
+// polygons are fanned into triangles, UVs are flipped and corners without a
+// normal get their face normal. Points and lines are skipped.
+bool ImportObj(const std::string& path, std::vector<MeshData>& meshes, ObjImportStats* stats = nullptr);
@@ -0,0 +1,202 @@
+#include "ParticleEffects.h"
+
+#include <iostream>
+
+namespace
+{
+    ParticleLook bakeLook(const EmitterSettings& settings)
+    {
+        ParticleLook look;
+        for (int i = 0; i < ParticleLook::Samples; i++)
+        {
+            float age = float(i) / (ParticleLook::Samples - 1);
+            look.size[i] = settings.size.Evaluate(age);
+            look.color[i] = PackParticleColor(settings.color.Evaluate(age));
+        }
+        return look;
+    }
+
+    float jitter(FastRandom& random, float amount)
+    {
+        return random.Range(-amount, amount);
+    }
+}
+
+EmitterSettings RainEmitter()
+{
+    EmitterSettings settings;
+    settings.budget = 1000;
+    settings.rate = 250.0f;
+    settings.extent = glm::vec3(50.0f, 5.0f, 50.0f);
+    settings.velocity = glm::vec3(0.0f, -8.0f, 0.0f);
+    settings.velocityJitter = glm::vec3(0.2f, 1.0f, 0.2f);
+    settings.minLifetime = 3.5f;
+    settings.maxLifetime = 4.5f;
+    // Already at terminal velocity.
+    settings.gravityScale = 0.0f;
+    settings.size = 0.08f;
+    settings.color = glm::vec4(0.75f, 0.8f, 0.9f, 0.7f);
+    return settings;
+}
+
+EmitterSettings SnowEmitter()
+{
+    EmitterSettings settings;
+    settings.budget = 1000;
+    settings.rate = 70.0f;
+    settings.extent = glm::vec3(50.0f, 5.0f, 50.0f);
+    settings.velocity = glm::vec3(0.0f, -1.0f, 0.0f);
+    settings.velocityJitter = glm::vec3(0.5f, 0.2f, 0.5f);
+    settings.minLifetime = 12.0f;
+    settings.maxLifetime = 16.0f;
+    settings.gravityScale = 0.0f;
+    settings.size = 0.15f;
+    settings.color = { { 0.0f, glm::vec4(1.0f) }, { 0.8f, glm::vec4(1.0f) }, { 1.0f, glm::vec4(1.0f, 1.0f, 1.0f, 0.0f) } };
+    return settings;
+}
+
+EmitterSettings ExhaustEmitter()
+{
+    EmitterSettings settings;
+    settings.budget = 400;
+    settings.rate = 150.0f;
+    settings.extent = glm::vec3(0.05f);
+    settings.velocity = glm::vec3(0.0f, 0.2f, 0.0f);
+    settings.velocityJitter = glm::vec3(0.15f);
+    settings.inheritVelocity = 0.2f;
+    settings.minLifetime = 1.0f;
+    settings.maxLifetime = 2.0f;
+    // Warm exhaust rises a little.
+    settings.gravityScale = -0.02f;
+    settings.size = { { 0.0f, 0.05f }, { 1.0f, 0.5f } };
+    settings.color = { { 0.0f, glm::vec4(0.6f, 0.6f, 0.6f, 0.5f) }, { 1.0f, glm::vec4(0.35f, 0.35f, 0.35f, 0.2f) } };
+    return settings;
+}
+
+EmitterSettings TouchdownDustEmitter()
+{
+    EmitterSettings settings;
+    settings.budget = 300;
+    // Bursts only, on touchdown.
+    settings.rate = 0.0f;
+    settings.extent = glm::vec3(1.0f, 0.1f, 1.0f);
+    settings.velocity = glm::vec3(0.0f, 1.5f, 0.0f);
+    settings.velocityJitter = glm::vec3(3.0f, 1.0f, 3.0f);
+    settings.minLifetime = 1.5f;
+    settings.maxLifetime = 3.0f;
+    settings.gravityScale = 0.3f;
+    settings.size = { { 0.0f, 0.3f }, { 1.0f, 1.5f } };
+    settings.color = glm::vec4(0.6f, 0.52f, 0.4f, 0.6f);
+    return settings;
+}
+
+ParticleEmitter::ParticleEmitter(ParticleEffects& owner, const EmitterSettings& settings, uint16_t group)
+    : owner(owner), settings(settings), group(group)
+{
+}
+
+size_t ParticleEmitter::Live() const
+{
+    return owner.System().GroupCount(group);
+}
+
+ParticleEffects::ParticleEffects(size_t capacity)
+    : system(capacity), emitters(ParticleSystem::MaxGroups), looks(ParticleSystem::MaxGroups)
+{
+}
+
+ParticleEmitter* ParticleEffects::CreateEmitter(const EmitterSettings& settings)
+{
+    if (settings.budget > system.Capacity() - reserved)
+    {
+        std::cout << "ERROR::PARTICLES::Emitter budget of " << settings.budget << " exceeds the "
+            << system.Capacity() - reserved << " unreserved particles" << std::endl;
+        return nullptr;
+    }
+
+    for (size_t group = 0; group < emitters.size(); group++)
+    {
+        // A group is reused only once the previous emitter's particles are gone.
+        if (emitters[group] || system.GroupCount(uint16_t(group)) > 0)
+            continue;
+
+        emitters[group].reset(new ParticleEmitter(*this, settings, uint16_t(group)));
+        looks[group] = bakeLook(settings);
+        reserved += settings.budget;
+        return emitters[group].get();
+    }
+
+    std::cout << "ERROR::PARTICLES::No more than " << ParticleSystem::MaxGroups << " emitters" << std::endl;
+    return nullptr;
+}
+
+void ParticleEffects::DestroyEmitter(ParticleEmitter* emitter)
+{
+    if (!emitter)
+        return;
+
+    uint16_t group = emitter->group;
+    system.Kill(group);
+    reserved -= emitter->settings.budget;
+    emitters[group].reset();
+}
+
+void ParticleEffects::Update(float deltaTime)
+{
+    // Spawn first so new particles are integrated and drawn this frame.
+    for (const auto& emitter : emitters)
+        if (emitter)
+            emit(*emitter, deltaTime);
+    system.Update(deltaTime);
+}
+
+void ParticleEffects::emit(ParticleEmitter& emitter, float deltaTime)
+{
+    // The first position set is where the emitter starts, not a jump from the origin.
+    if (!emitter.moved)
+    {
+        emitter.previousPosition = emitter.position;
+        emitter.moved = true;
+    }
+
+    const EmitterSettings& settings = emitter.settings;
+    size_t due = emitter.pendingBurst;
+    emitter.pendingBurst = 0;
+    if (emitter.enabled)
+    {
+        emitter.accumulator += settings.rate * emitter.rateScale * deltaTime;
+        due += size_t(emitter.accumulator);
+        emitter.accumulator -= float(size_t(emitter.accumulator));
+    }
+
+    size_t live = system.GroupCount(emitter.group);
+    size_t allowed = live < settings.budget ? settings.budget - live : 0;
+    glm::vec3 from = emitter.previousPosition;
+    glm::vec3 to = emitter.position;
+    glm::vec3 baseVelocity = settings.velocity + emitter.velocity * settings.inheritVelocity;
+    emitter.previousPosition = emitter.position;
+    if (due == 0 || allowed == 0)
+        return;
+
+    system.Emit(std::min(due, allowed), [&](ParticleInit& p, FastRandom& random)
+    {
+        glm::vec3 origin = glm::mix(from, to, random.Float());
+        p.position = origin + glm::vec3(jitter(random, settings.extent.x), jitter(random, settings.extent.y), jitter(random, settings.extent.z));
+        p.velocity = baseVelocity + glm::vec3(jitter(random, settings.velocityJitter.x),
+            jitter(random, settings.velocityJitter.y), jitter(random, settings.velocityJitter.z));
+        p.lifetime = random.Range(settings.minLifetime, settings.maxLifetime);
+        p.gravityScale = settings.gravityScale;
+    }, emitter.group);
+}
+
+ParticleEffects::Occupancy ParticleEffects::GetOccupancy() const
+{
+    Occupancy occupancy;
+    occupancy.capacity = system.Capacity();
+    occupancy.reserved = reserved;
+    occupancy.live = system.Count();
+    for (const auto& emitter : emitters)
+        if (emitter)
+            occupancy.emitters++;
+    return occupancy;
+}
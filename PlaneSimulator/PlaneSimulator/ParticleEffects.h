@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <glm.hpp>
+
+#include "ParticleSystem.h"
+
+// Piecewise linear value over a particle's life: keys are (age, value) with
+// ages from 0 at birth to 1 at death, in increasing order.
+template <typename T>
+struct LifetimeCurve
+{
+    std::vector<std::pair<float, T>> keys;
+
+    LifetimeCurve(const T& constant) : keys{ { 0.0f, constant } } {}
+    LifetimeCurve(std::initializer_list<std::pair<float, T>> points) : keys(points) {}
+
+    T Evaluate(float age) const
+    {
+        if (age <= keys.front().first)
+            return keys.front().second;
+        for (size_t i = 1; i < keys.size(); i++)
+        {
+            if (age <= keys[i].first)
+            {
+                float t = (age - keys[i - 1].first) / (keys[i].first - keys[i - 1].first);
+                return glm::mix(keys[i - 1].second, keys[i].second, t);
+            }
+        }
+        return keys.back().second;
+    }
+};
+
+// What an emitter spawns and how fast. Positions are uniform in a box around
+// the emitter, velocities uniform around a base value.
+struct EmitterSettings
+{
+    // Most particles of this emitter alive at once, reserved from the pool when the emitter is created.
+    size_t budget = 100;
+    // Particles per second; 0 for emitters that only Burst.
+    float rate = 10.0f;
+    glm::vec3 extent = glm::vec3(0.0f);
+    glm::vec3 velocity = glm::vec3(0.0f);
+    glm::vec3 velocityJitter = glm::vec3(0.0f);
+    // Fraction of the emitter's own velocity the particles start with.
+    float inheritVelocity = 0.0f;
+    float minLifetime = 1.0f;
+    float maxLifetime = 1.0f;
+    float gravityScale = 1.0f;
+    LifetimeCurve<float> size = 0.2f;
+    // Multiplied by particle.vs's own fade over the lifetime.
+    LifetimeCurve<glm::vec4> color = glm::vec4(1.0f);
+};
+
+// Presets for the effects the simulator uses; adjust the returned settings as needed.
+EmitterSettings RainEmitter();
+EmitterSettings SnowEmitter();
+EmitterSettings ExhaustEmitter();
+EmitterSettings TouchdownDustEmitter();
+
+class ParticleEffects;
+
+// One source of particles, owned by ParticleEffects. Move it with the object
+// it is attached to; spawns are spread along the path since the last update.
+class ParticleEmitter
+{
+public:
+    const EmitterSettings& Settings() const { return settings; }
+    uint16_t Group() const { return group; }
+
+    void SetPosition(const glm::vec3& newPosition) { position = newPosition; }
+    void SetVelocity(const glm::vec3& newVelocity) { velocity = newVelocity; }
+    // Scales the spawn rate, e.g. with throttle.
+    void SetRateScale(float scale) { rateScale = scale; }
+    void SetEnabled(bool enable) { enabled = enable; }
+    // Spawns count extra particles on the next update, within the budget.
+    void Burst(size_t count) { pendingBurst += count; }
+
+    // Particles of this emitter currently alive.
+    size_t Live() const;
+
+private:
+    friend class ParticleEffects;
+
+    ParticleEmitter(ParticleEffects& owner, const EmitterSettings& settings, uint16_t group);
+
+    ParticleEffects& owner;
+    EmitterSettings settings;
+    uint16_t group;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 previousPosition = glm::vec3(0.0f);
+    glm::vec3 velocity = glm::vec3(0.0f);
+    float rateScale = 1.0f;
+    // Fractional particles owed by the spawn rate, carried between frames.
+    float accumulator = 0.0f;
+    size_t pendingBurst = 0;
+    bool enabled = true;
+    bool moved = false;
+};
+
+// Fixed-capacity particle pool shared by every emitter. Each emitter reserves
+// its budget up front and creation fails once the pool is fully reserved, so
+// the pool never grows, emitters never starve each other and a long session
+// allocates nothing after start-up.
+class ParticleEffects
+{
+public:
+    struct Occupancy
+    {
+        size_t capacity = 0;
+        // Sum of the budgets of the live emitters.
+        size_t reserved = 0;
+        size_t live = 0;
+        size_t emitters = 0;
+    };
+
+    explicit ParticleEffects(size_t capacity);
+
+    // nullptr if the budget does not fit in what is left unreserved, or every group is taken.
+    ParticleEmitter* CreateEmitter(const EmitterSettings& settings);
+    // Frees the emitter's budget; its particles are removed by the next update.
+    void DestroyEmitter(ParticleEmitter* emitter);
+
+    // Spawns what every enabled emitter owes, then advances the simulation.
+    void Update(float deltaTime);
+
+    // Fills out[0, Count()) for ParticleRenderer.
+    void WriteVertices(ParticleVertex* out) const { system.WriteVertices(out, looks.data()); }
+    size_t Count() const { return system.Count(); }
+    Occupancy GetOccupancy() const;
+
+    // Gravity and ground collision apply to every emitter.
+    ParticleSystem& System() { return system; }
+    const ParticleSystem& System() const { return system; }
+
+private:
+    void emit(ParticleEmitter& emitter, float deltaTime);
+
+    ParticleSystem system;
+    std::vector<std::unique_ptr<ParticleEmitter>> emitters;
+    std::vector<ParticleLook> looks;
+    size_t reserved = 0;
+};
@@ -0,0 +1,128 @@
+#include "ParticleRenderer.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "GLState.h"
+#include "RenderStats.h"
+
+namespace
+{
+    // Corners of the unit sprite, drawn as a triangle strip.
+    const float QuadCorners[8] = { -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f };
+}
+
+ParticleRenderer::~ParticleRenderer()
+{
+    Release();
+}
+
+void ParticleRenderer::create()
+{
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &quadBuffer);
+    glGenBuffers(1, &instanceBuffer);
+
+    GLState& state = GLState::Get();
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, quadBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(QuadCorners), QuadCorners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+    state.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, position));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, color));
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(ParticleVertex), (void*)offsetof(ParticleVertex, age));
+    glVertexAttribDivisor(3, 1);
+}
+
+void ParticleRenderer::reserve(size_t needed)
+{
+    if (!vao)
+        create();
+
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (needed > capacity)
+        capacity = std::max(needed, capacity * 2);
+    // Respecifying the store every frame lets the driver hand out fresh memory
+    // while last frame's draw still reads the old one.
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(ParticleVertex), NULL, GL_STREAM_DRAW);
+}
+
+ParticleVertex* ParticleRenderer::Map(size_t needed)
+{
+    count = 0;
+    if (needed == 0)
+        return nullptr;
+
+    reserve(needed);
+    void* data = glMapBufferRange(GL_ARRAY_BUFFER, 0, needed * sizeof(ParticleVertex), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!data)
+    {
+        std::cout << "ERROR::PARTICLES::Failed to map the instance buffer" << std::endl;
+        return nullptr;
+    }
+    mapped = true;
+    return static_cast<ParticleVertex*>(data);
+}
+
+void ParticleRenderer::Unmap(size_t written)
+{
+    if (!mapped)
+        return;
+
+    GLState::Get().BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    mapped = false;
+    // A false return means the store was lost while mapped (e.g. a mode switch); skip the frame.
+    count = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE ? written : 0;
+}
+
+void ParticleRenderer::Upload(const ParticleVertex* particles, size_t particleCount)
+{
+    count = 0;
+    if (particleCount == 0)
+        return;
+
+    reserve(particleCount);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, particleCount * sizeof(ParticleVertex), particles);
+    count = particleCount;
+}
+
+void ParticleRenderer::Draw(Shader& shader)
+{
+    if (count == 0 || mapped)
+        return;
+
+    GLState& state = GLState::Get();
+    shader.use();
+    state.Enable(GL_BLEND);
+    state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    state.DepthMask(false);
+    state.BindVertexArray(vao);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(count));
+    RenderStats::Get().AddDraw(2 * count, 2 * count);
+
+    state.DepthMask(true);
+    state.Disable(GL_BLEND);
+}
+
+void ParticleRenderer::Release()
+{
+    GLState& state = GLState::Get();
+    if (vao)
+        state.DeleteVertexArrays(1, &vao);
+    if (quadBuffer)
+        state.DeleteBuffers(1, &quadBuffer);
+    if (instanceBuffer)
+        state.DeleteBuffers(1, &instanceBuffer);
+    vao = quadBuffer = instanceBuffer = 0;
+    capacity = count = 0;
+    mapped = false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <glm.hpp>
+
+#include "Shader.h"
+
+// One particle as the GPU reads it: 24 bytes per instance.
+struct ParticleVertex
+{
+    glm::vec3 position;
+    // Edge length of the sprite in world units.
+    float size;
+    // RGBA8, red in the low byte.
+    uint32_t color;
+    // Fraction of the lifetime used up, 0 at birth and 1 at death; the sprite fades out with it.
+    float age;
+};
+
+static_assert(sizeof(ParticleVertex) == 24, "ParticleVertex is read as a tightly packed instance attribute");
+
+inline uint32_t PackParticleColor(const glm::vec4& color)
+{
+    glm::vec4 c = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return uint32_t(c.r) | (uint32_t(c.g) << 8) | (uint32_t(c.b) << 16) | (uint32_t(c.a) << 24);
+}
+
+// Draws one emitter's particles as camera-facing quads (particle.vs/fs) with
+// a single instanced call. Particles stream through an instance buffer that
+// is orphaned and rewritten every frame, so a large emitter costs one upload
+// and one draw however many particles it has. Owns its GL objects, so it can
+// not be copied. GL thread only.
+class ParticleRenderer
+{
+public:
+    ParticleRenderer() = default;
+    ~ParticleRenderer();
+
+    ParticleRenderer(const ParticleRenderer&) = delete;
+    ParticleRenderer& operator=(const ParticleRenderer&) = delete;
+
+    // Space for count particles to be written this frame, or nullptr if the
+    // buffer could not be mapped. Must be followed by Unmap before Draw.
+    ParticleVertex* Map(size_t count);
+    // Makes the first count particles of the mapping drawable.
+    void Unmap(size_t count);
+    void Upload(const ParticleVertex* particles, size_t count);
+
+    // Draws what was last uploaded, alpha blended without depth writes; call after the opaque geometry.
+    void Draw(Shader& shader);
+
+    size_t Count() const { return count; }
+    // Deletes the GL objects early; the destructor does it otherwise.
+    void Release();
+
+private:
+    void create();
+    // Orphans the instance store, growing it to hold at least count particles.
+    void reserve(size_t count);
+
+    GLuint vao = 0;
+    GLuint quadBuffer = 0;
+    GLuint instanceBuffer = 0;
+    size_t capacity = 0;
+    size_t count = 0;
+    bool mapped = false;
+};
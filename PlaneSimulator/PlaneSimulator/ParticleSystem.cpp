@@ -0,0 +1,235 @@
+#include "ParticleSystem.h"
+
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <xmmintrin.h>
+
+#include "Heightfield.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    // Float arrays in the block; the group array follows them.
+    const int ArrayCount = 9;
+
+    size_t roundUp4(size_t value)
+    {
+        return (value + 3) & ~size_t(3);
+    }
+
+    // splitmix64 finalizer; turns nearby seeds into unrelated states.
+    uint64_t mixSeed(uint64_t value)
+    {
+        value += 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    // a where mask is set, b elsewhere (SSE2 has no blendv).
+    __m128 select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+}
+
+FastRandom::FastRandom(uint64_t seed)
+    : state(mixSeed(seed))
+{
+    // xorshift never leaves zero.
+    if (state == 0)
+        state = 1;
+}
+
+FastRandom& ThreadRandom()
+{
+    thread_local FastRandom random(std::hash<std::thread::id>()(std::this_thread::get_id())
+        ^ uint64_t(std::chrono::high_resolution_clock::now().time_since_epoch().count()));
+    return random;
+}
+
+ParticleSystem::ParticleSystem(size_t maxParticles)
+    : capacity(maxParticles)
+{
+    size_t stride = roundUp4(std::max<size_t>(capacity, 1));
+    block = static_cast<float*>(_mm_malloc(ArrayCount * stride * sizeof(float) + stride * sizeof(uint16_t), 16));
+    float* arrays[ArrayCount];
+    for (int i = 0; i < ArrayCount; i++)
+        arrays[i] = block + i * stride;
+    positionX = arrays[0];
+    positionY = arrays[1];
+    positionZ = arrays[2];
+    velocityX = arrays[3];
+    velocityY = arrays[4];
+    velocityZ = arrays[5];
+    life = arrays[6];
+    inverseLifetime = arrays[7];
+    gravityScale = arrays[8];
+    group = reinterpret_cast<uint16_t*>(block + ArrayCount * stride);
+    // The padding past the last particle is integrated too; keep it finite.
+    std::fill(block, block + ArrayCount * stride, 0.0f);
+    std::fill(group, group + stride, uint16_t(0));
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    _mm_free(block);
+}
+
+void ParticleSystem::store(size_t index, const ParticleInit& particle, uint16_t particleGroup)
+{
+    positionX[index] = particle.position.x;
+    positionY[index] = particle.position.y;
+    positionZ[index] = particle.position.z;
+    velocityX[index] = particle.velocity.x;
+    velocityY[index] = particle.velocity.y;
+    velocityZ[index] = particle.velocity.z;
+    life[index] = particle.lifetime;
+    inverseLifetime[index] = particle.lifetime > 0.0f ? 1.0f / particle.lifetime : 0.0f;
+    gravityScale[index] = particle.gravityScale;
+    group[index] = particleGroup;
+}
+
+void ParticleSystem::Kill(uint16_t particleGroup)
+{
+    if (groupCounts[particleGroup] == 0)
+        return;
+    for (size_t i = 0; i < count; i++)
+        if (group[i] == particleGroup)
+            life[i] = 0.0f;
+}
+
+void ParticleSystem::Clear()
+{
+    count = 0;
+    groupCounts.fill(0);
+}
+
+void ParticleSystem::Update(float deltaTime, bool parallel)
+{
+    if (count == 0)
+        return;
+
+    // Whole groups of four; the arrays are padded, so the last group may run past count.
+    size_t end = roundUp4(count);
+    size_t chunks = (end + ChunkSize - 1) / ChunkSize;
+    if (parallel && chunks > 1)
+    {
+        ThreadPool::Shared().ParallelFor(chunks, [&](size_t chunk)
+        {
+            size_t begin = chunk * ChunkSize;
+            integrate(begin, std::min(begin + ChunkSize, end), deltaTime);
+        });
+    }
+    else
+        integrate(0, end, deltaTime);
+
+    removeDead();
+}
+
+void ParticleSystem::integrate(size_t begin, size_t end, float deltaTime)
+{
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 gravityX = _mm_set1_ps(gravity.x * deltaTime);
+    const __m128 gravityY = _mm_set1_ps(gravity.y * deltaTime);
+    const __m128 gravityZ = _mm_set1_ps(gravity.z * deltaTime);
+    const __m128 groundHeight = _mm_set1_ps(ground.height);
+    const __m128 bounce = _mm_set1_ps(-ground.restitution);
+    const __m128 friction = _mm_set1_ps(ground.friction);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (size_t i = begin; i < end; i += 4)
+    {
+        // Semi-implicit Euler: the new velocity moves the particle.
+        __m128 scale = _mm_load_ps(gravityScale + i);
+        __m128 vx = _mm_add_ps(_mm_load_ps(velocityX + i), _mm_mul_ps(gravityX, scale));
+        __m128 vy = _mm_add_ps(_mm_load_ps(velocityY + i), _mm_mul_ps(gravityY, scale));
+        __m128 vz = _mm_add_ps(_mm_load_ps(velocityZ + i), _mm_mul_ps(gravityZ, scale));
+        __m128 px = _mm_add_ps(_mm_load_ps(positionX + i), _mm_mul_ps(vx, dt));
+        __m128 py = _mm_add_ps(_mm_load_ps(positionY + i), _mm_mul_ps(vy, dt));
+        __m128 pz = _mm_add_ps(_mm_load_ps(positionZ + i), _mm_mul_ps(vz, dt));
+
+        if (ground.enabled)
+        {
+            // Only particles below the ground and still falling bounce.
+            __m128 surface = ground.terrain ? ground.terrain->HeightsAt(px, pz) : groundHeight;
+            __m128 hit = _mm_and_ps(_mm_cmplt_ps(py, surface), _mm_cmplt_ps(vy, zero));
+            py = select(hit, surface, py);
+            vy = select(hit, _mm_mul_ps(vy, bounce), vy);
+            __m128 keep = select(hit, friction, one);
+            vx = _mm_mul_ps(vx, keep);
+            vz = _mm_mul_ps(vz, keep);
+        }
+
+        _mm_store_ps(velocityX + i, vx);
+        _mm_store_ps(velocityY + i, vy);
+        _mm_store_ps(velocityZ + i, vz);
+        _mm_store_ps(positionX + i, px);
+        _mm_store_ps(positionY + i, py);
+        _mm_store_ps(positionZ + i, pz);
+        _mm_store_ps(life + i, _mm_sub_ps(_mm_load_ps(life + i), dt));
+    }
+}
+
+void ParticleSystem::removeDead()
+{
+    float* arrays[ArrayCount] = { positionX, positionY, positionZ, velocityX, velocityY, velocityZ, life, inverseLifetime, gravityScale };
+    const __m128 zero = _mm_setzero_ps();
+
+    size_t i = 0;
+    while (i < count)
+    {
+        // Most groups of four are all alive; skip them with one compare. A removal
+        // leaves i unaligned, hence the unaligned load.
+        if (i + 4 <= count && _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(life + i), zero)) == 0)
+        {
+            i += 4;
+            continue;
+        }
+        if (life[i] > 0.0f)
+        {
+            i++;
+            continue;
+        }
+
+        // Move the last particle into the hole and look at slot i again.
+        groupCounts[group[i]]--;
+        count--;
+        for (float* array : arrays)
+            array[i] = array[count];
+        group[i] = group[count];
+    }
+}
+
+void ParticleSystem::WriteVertices(ParticleVertex* out, const ParticleLook* looks) const
+{
+    auto write = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            float age = std::min(std::max(1.0f - life[i] * inverseLifetime[i], 0.0f), 1.0f);
+            int sample = int(age * (ParticleLook::Samples - 1) + 0.5f);
+            const ParticleLook& look = looks[group[i]];
+
+            ParticleVertex& vertex = out[i];
+            vertex.position = glm::vec3(positionX[i], positionY[i], positionZ[i]);
+            vertex.size = look.size[sample];
+            vertex.color = look.color[sample];
+            vertex.age = age;
+        }
+    };
+
+    size_t chunks = (count + ChunkSize - 1) / ChunkSize;
+    if (chunks > 1)
+    {
+        ThreadPool::Shared().ParallelFor(chunks, [&](size_t chunk)
+        {
+            size_t begin = chunk * ChunkSize;
+            write(begin, std::min(begin + ChunkSize, count));
+        });
+    }
+    else
+        write(0, count);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm.hpp>
+
+#include "ParticleRenderer.h"
+
+class Heightfield;
+
+// xorshift64* generator: a few instructions per number, good enough for
+// particle jitter. Not thread-safe; each thread uses its own (ThreadRandom).
+class FastRandom
+{
+public:
+    explicit FastRandom(uint64_t seed);
+
+    uint32_t Next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return uint32_t((state * 2685821657736338717ull) >> 32);
+    }
+
+    // Uniform in [0, 1).
+    float Float() { return (Next() >> 8) * (1.0f / 16777216.0f); }
+    float Range(float low, float high) { return low + (high - low) * Float(); }
+
+private:
+    uint64_t state;
+};
+
+// Generator of the calling thread, seeded differently on every thread.
+FastRandom& ThreadRandom();
+
+// Cheap response against the ground: particles that sink below it are put
+// back on it and bounce with some energy lost.
+struct GroundCollision
+{
+    bool enabled = false;
+    // A horizontal plane at height, unless terrain is set.
+    float height = 0.0f;
+    // Follows this surface instead, four particles per batched query.
+    const Heightfield* terrain = nullptr;
+    // Fraction of the vertical speed kept after a bounce.
+    float restitution = 0.3f;
+    // Fraction of the horizontal speed kept after a bounce.
+    float friction = 0.8f;
+};
+
+// State of a new particle, filled in by the initializer passed to Emit.
+struct ParticleInit
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 velocity = glm::vec3(0.0f);
+    float lifetime = 1.0f;
+    // Multiplies the system's gravity: 0 drifts at a constant velocity, negative rises.
+    float gravityScale = 1.0f;
+};
+
+// Size and colour over a particle's life, sampled at evenly spaced ages from
+// birth to death. WriteVertices picks the nearest sample for each particle.
+struct ParticleLook
+{
+    static const int Samples = 16;
+
+    float size[Samples];
+    uint32_t color[Samples];
+};
+
+// Particle simulation with structure-of-arrays storage: every attribute is
+// its own 16-byte aligned array, and the live particles are always the first
+// Count() entries. Update integrates four particles per SSE instruction over
+// chunks spread across the shared ThreadPool, then swap-removes the dead, so
+// nothing walks inactive slots and nothing keeps an "active" flag. Every
+// particle carries a group (its emitter, see ParticleEffects) that is counted
+// separately and selects its look.
+class ParticleSystem
+{
+public:
+    static const size_t MaxGroups = 64;
+
+    explicit ParticleSystem(size_t capacity);
+    ~ParticleSystem();
+
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    size_t Capacity() const { return capacity; }
+    size_t Count() const { return count; }
+    size_t GroupCount(uint16_t group) const { return groupCounts[group]; }
+
+    void SetGravity(const glm::vec3& acceleration) { gravity = acceleration; }
+    void SetGroundCollision(const GroundCollision& ground) { this->ground = ground; }
+
+    // Appends up to requested particles of group, as many as fit, each set up
+    // by init(ParticleInit&, FastRandom&). Returns how many were added.
+    template <typename Init>
+    size_t Emit(size_t requested, Init&& init, uint16_t group = 0);
+
+    // Advances every particle by deltaTime and removes the ones whose lifetime ran out.
+    // parallel = false keeps the work on the calling thread, for measuring a single core.
+    void Update(float deltaTime, bool parallel = true);
+    // Ends the life of every particle in group; they are removed by the next Update.
+    void Kill(uint16_t group);
+    void Clear();
+
+    // Fills out[0, Count()) for ParticleRenderer, sizing and colouring each
+    // particle from looks[its group] at its age.
+    void WriteVertices(ParticleVertex* out, const ParticleLook* looks) const;
+
+private:
+    // Particles per parallel work item; a multiple of four.
+    static const size_t ChunkSize = 16 * 1024;
+
+    void integrate(size_t begin, size_t end, float deltaTime);
+    void removeDead();
+    void store(size_t index, const ParticleInit& particle, uint16_t group);
+
+    size_t capacity = 0;
+    size_t count = 0;
+    glm::vec3 gravity = glm::vec3(0.0f);
+    GroundCollision ground;
+
+    // One allocation holding every array; each is padded to a multiple of four.
+    float* block = nullptr;
+    float* positionX = nullptr;
+    float* positionY = nullptr;
+    float* positionZ = nullptr;
+    float* velocityX = nullptr;
+    float* velocityY = nullptr;
+    float* velocityZ = nullptr;
+    // Seconds left to live, and 1 / lifetime at birth for the age.
+    float* life = nullptr;
+    float* inverseLifetime = nullptr;
+    float* gravityScale = nullptr;
+    uint16_t* group = nullptr;
+    std::array<size_t, MaxGroups> groupCounts = {};
+};
+
+template <typename Init>
+size_t ParticleSystem::Emit(size_t requested, Init&& init, uint16_t group)
+{
+    size_t added = std::min(requested, capacity - count);
+    FastRandom& random = ThreadRandom();
+    for (size_t i = 0; i < added; i++)
+    {
+        ParticleInit particle;
+        init(particle, random);
+        store(count + i, particle, group);
+    }
+    count += added;
+    groupCounts[group] += added;
+    return added;
+}
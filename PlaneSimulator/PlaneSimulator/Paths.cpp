@@ -0,0 +1,17 @@
+#include "Paths.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+std::string CanonicalPath(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::path canonical = std::filesystem::weakly_canonical(std::filesystem::path(path), error);
+    std::string key = error ? path : canonical.string();
+#ifdef _WIN32
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    std::replace(key.begin(), key.end(), '/', '\\');
+#endif
+    return key;
+}
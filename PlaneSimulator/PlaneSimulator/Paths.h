@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+
+// Absolute, normalized form of path used as a key by the asset caches. On
+// Windows it is also case-folded and uses backslashes, since the file system
+// treats those spellings as the same file.
+std::string CanonicalPath(const std::string& path);
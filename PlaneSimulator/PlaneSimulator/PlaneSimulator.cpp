@@ -18,9 +18,26 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <filesystem>
 #include "Shader.h"
 #include "Mesh.h"
 #include "Model.h"
+#include "ModelCache.h"
+#include "AssetLoader.h"
+#include "GeometryArena.h"
+#include "FrameData.h"
+#include "GLState.h"
+#include "Heightfield.h"
+#include "ParticleRenderer.h"
+#include "ParticleEffects.h"
+#include "RenderQueue.h"
+#include "RenderStats.h"
+#include "SphereCuller.h"
+#include "Terrain.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "Benchmarks.h"
+#include "TextureCooker.h"
 
 #pragma comment (lib, "glfw3dll.lib")
 #pragma comment (lib, "glew32.lib")
@@ -38,7 +55,7 @@ struct BoundingSphere {
 };
 
 struct SceneObject {
-	Model* model;
+	ModelHandle model;
 	BoundingSphere bounding;
 	glm::vec3 position;
 	glm::vec3 scale;
@@ -150,56 +167,62 @@ std::vector<std::string> faces{
 	"path/to/pz.jpg"
 };
 
-void renderModel(Shader& ourShader, Model& ourModel, const glm::vec3& position, float rotationAngle, const glm::vec3& scale);
-void renderModelPlane(Shader& ourShader, Model& ourModel, const glm::vec3& position, float rotationAngle, const glm::vec3& scale);
-void renderModelParkedPlane(Shader& ourShader, Model& ourModel, const glm::vec3& position, float rotationAngle, const glm::vec3& scale);
-void renderModel(Shader& ourShader, Model& ourModel, const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale);
-void renderModelParkedPlane(Shader& ourShader, Model& ourModel, const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale);
-void renderModelPlane(Shader& ourShader, Model& ourModel, const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale);
-void renderTerrain(Shader& terrainShader, Model& terrainModel, const glm::vec3& position, const glm::vec3& scale, int terrainTexture);
+glm::mat4 modelTransform(const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale);
+RenderQueue::Object sceneObject(Shader& shader, Model& model, const glm::mat4& transform, bool selectLod = false);
+void cullInstances(SphereCuller& culler, const Frustum& frustum, const Model& model, const std::vector<glm::mat4>& transforms);
 
 
 
 unsigned int CreateTexture(const std::string& strTexturePath)
 {
-	unsigned int textureId = -1;
-
-	int width, height, nrChannels;
-	unsigned char* data = stbi_load(strTexturePath.c_str(), &width, &height, &nrChannels, 0);
-	if (data) {
-		GLenum format;
-		if (nrChannels == 1)
-			format = GL_RED;
-		else if (nrChannels == 3)
-			format = GL_RGB;
-		else if (nrChannels == 4)
-			format = GL_RGBA;
-
-		glGenTextures(1, &textureId);
-		glBindTexture(GL_TEXTURE_2D, textureId);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	}
-	else {
+	ImageData image;
+	if (!image.Load(strTexturePath)) {
 		std::cout << "Failed to load texture: " << strTexturePath << std::endl;
 		std::cerr << "Failed to load texture: " << stbi_failure_reason() << std::endl;
+		return -1;
+	}
+
+	TextureParams params;
+	params.clampAlpha = true;
+	return UploadTexture(image, params);
+}
+
+// Uploads cooked faces when all six are present, since a cube map needs matching formats on every face
+bool LoadCookedSkyboxFaces(const std::vector<std::string>& faces)
+{
+	if (!CompressedTexturesSupported())
+		return false;
+
+	std::vector<CompressedImage> images(faces.size());
+	for (unsigned int i{ 0 }; i < faces.size(); ++i)
+	{
+		if (!IsCookedTextureCurrent(faces[i]) || !images[i].Load(CookedTexturePath(faces[i])))
+			return false;
+		if (images[i].internalFormat != images[0].internalFormat || images[i].levels.size() != images[0].levels.size())
+			return false;
 	}
-	stbi_image_free(data);
 
-	return textureId;
+	for (unsigned int i{ 0 }; i < faces.size(); ++i)
+		SpecifyCompressedLevels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, images[i], false);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(images[0].levels.size()) - 1);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	return true;
 }
 
 unsigned int LoadSkybox(std::vector<std::string> faces)
 {
 	unsigned int textureID;
 	glGenTextures(1, &textureID);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	GLState::Get().BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+	if (LoadCookedSkyboxFaces(faces))
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		return textureID;
+	}
+
 	int width, height, nrChannels;
 	for (unsigned int i{ 0 }; i < faces.size(); ++i)
 	{
@@ -220,11 +243,24 @@ unsigned int LoadSkybox(std::vector<std::string> faces)
 	return textureID;
 }
 
+std::vector<std::string> SkyboxFaces(const std::string& folder)
+{
+	return {
+		folder + "px.png",
+		folder + "nx.png",
+		folder + "py.png",
+		folder + "ny.png",
+		folder + "pz.png",
+		folder + "nz.png"
+	};
+}
+
 struct Cloud {
 	glm::vec3 position;
 	glm::vec3 scale;
 	float rotation;
 	float speed;
+	int lod = 0; // level of detail drawn last frame
 };
 
 class Camera
@@ -343,6 +379,11 @@ public:
 		return position;
 	}
 
+	int GetHeight() const
+	{
+		return height;
+	}
+
 	const glm::mat4 GetProjectionMatrix() const
 	{
 		glm::mat4 Proj = glm::mat4(1);
@@ -586,9 +627,12 @@ protected:
 GLuint ProjMatrixLocation, ViewMatrixLocation, WorldMatrixLocation;
 Camera* pCamera = nullptr;
 
+void ReleaseModels();
+
 void Cleanup()
 {
 	delete pCamera;
+	ReleaseModels();
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
@@ -606,7 +650,15 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	}
 }
 
-Model airplane, parkedAirplane, tower, skybox, terrain, road, hangare, highFlyingAirplane, highFlyingAirplane2, landingPlane, cloud, building;
+ModelHandle airplane, parkedAirplane, tower, skybox, terrain, road, hangare, highFlyingAirplane, highFlyingAirplane2, landingPlane, cloud, building;
+
+// Drops every model handle so the shared GL resources are freed while the context is still alive.
+void ReleaseModels()
+{
+	sceneObjects.clear();
+	for (ModelHandle* handle : { &airplane, &parkedAirplane, &tower, &skybox, &terrain, &road, &hangare, &highFlyingAirplane, &highFlyingAirplane2, &landingPlane, &cloud, &building })
+		handle->reset();
+}
 
 glm::vec3 getSkyColor(float timeOfDay, std::string& skyboxPath) {
 	glm::vec3 dayColor(0.5f, 0.7f, 1.0f); 
@@ -649,68 +701,18 @@ float getLightIntensity(float timeOfDay) {
 }
 
 
-struct Particle {
-	glm::vec3 position;
-	glm::vec3 velocity;
-	float lifetime;  // Time remaining until the particle is 
-	bool active;
-};
-
-std::vector<Particle> particles;
-int numParticles = 1000;
-
-void initParticles() {
-	for (int i = 0; i < numParticles; ++i) {
-		Particle p;
-		p.position = glm::vec3(rand() % 100 - 50, rand() % 10 + 10, rand() % 100 - 50);
-		p.velocity = glm::vec3(0, -0.1, 0);  // Falling down
-		p.lifetime = rand() % 10 + 5;
-		p.active = true;
-		particles.push_back(p);
-	}
-}
-
-
-void updateParticles(float deltaTime) {
-	for (auto& p : particles) {
-		if (!p.active) continue;
+// Writes the live particles straight into the renderer's mapped instance buffer and draws them in one call.
+void renderParticles(ParticleEffects& effects, ParticleRenderer& renderer, Shader& shader) {
+	ParticleEffects::Occupancy occupancy = effects.GetOccupancy();
+	RenderStats::Get().SetParticles(occupancy.live, occupancy.capacity);
 
-		p.position += p.velocity * deltaTime;
-		p.lifetime -= deltaTime;
+	ParticleVertex* vertices = renderer.Map(effects.Count());
+	if (!vertices)
+		return;
 
-		if (p.lifetime <= 0) {
-			p.position.y = 10;
-			p.lifetime = rand() % 10 + 5;
-		}
-	}
-}
-
-GLuint sphereVAO;
-int sphereVertexCount;
-
-void renderParticles(Shader& shader) {
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	glBindVertexArray(sphereVAO); 
-
-
-	for (const auto& p : particles) {
-		if (!p.active) continue;
-
-		glm::mat4 model = glm::translate(glm::mat4(1.0f), p.position);
-		model = glm::scale(model, glm::vec3(0.1f));  
-
-		shader.use();
-		shader.setMat4("model", model);
-		shader.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
-		shader.setVec3("objectColor", glm::vec3(1.0f));  
-
-		glDrawArrays(GL_TRIANGLES, 0, sphereVertexCount);
-	}
-
-	glBindVertexArray(0);
-	glDisable(GL_BLEND);
+	effects.WriteVertices(vertices);
+	renderer.Unmap(effects.Count());
+	renderer.Draw(shader);
 }
 
 
@@ -737,7 +739,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 	// 1) Tower
 	{
 		SceneObject towerObj;
-		towerObj.model = &tower;
+		towerObj.model = tower;
 		towerObj.position = initialPosition + glm::vec3(-4.0f, -19.4f, -217.0f);
 		towerObj.scale = glm::vec3(1.3f);
 		towerObj.bounding.center = glm::vec3(0.0f);
@@ -748,7 +750,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 	// 2) Hangar
 	{
 		SceneObject hangarObj;
-		hangarObj.model = &hangare;
+		hangarObj.model = hangare;
 		hangarObj.position = initialPosition + glm::vec3(-28.0f, -19.4f, -10.0f);
 		hangarObj.scale = glm::vec3(0.3f);
 		hangarObj.bounding.center = glm::vec3(0.0f);
@@ -758,7 +760,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 	// 3) Road
 	{
 		SceneObject roadObj;
-		roadObj.model = &road;
+		roadObj.model = road;
 		roadObj.position = initialPosition + glm::vec3(45.0f, -19.0f, -7.0f);
 		roadObj.scale = glm::vec3(0.7f, 0.3f, 1.0f);
 		roadObj.bounding.center = glm::vec3(0.0f);
@@ -769,7 +771,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 	// 4) Building
 	{
 		SceneObject buildingObj;
-		buildingObj.model = &building;
+		buildingObj.model = building;
 		buildingObj.position = initialPosition + glm::vec3(-22.0f, -19.4f, -207.0f);
 		buildingObj.scale = glm::vec3(0.03f);
 		buildingObj.bounding.center = glm::vec3(0.0f);
@@ -779,7 +781,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 
 	{
 		SceneObject terrainObj;
-		terrainObj.model = &terrain;
+		terrainObj.model = terrain;
 		terrainObj.position = initialPosition + glm::vec3(10.0f, -30.0f, 0.0f);
 		terrainObj.scale = glm::vec3(0.01f);
 		terrainObj.bounding.center = glm::vec3(0.0f);
@@ -790,7 +792,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 
 	{
 		SceneObject groundAirplaneObj;
-		groundAirplaneObj.model = &airplane;
+		groundAirplaneObj.model = airplane;
 		groundAirplaneObj.position = glm::vec3(-50.0f, -19.8f, -55.0f);
 		groundAirplaneObj.scale = glm::vec3(0.0088f);
 		groundAirplaneObj.bounding.center = glm::vec3(0.0f);
@@ -800,7 +802,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 
 	{
 		SceneObject landingPlaneObj;
-		landingPlaneObj.model = &landingPlane;
+		landingPlaneObj.model = landingPlane;
 		landingPlaneObj.position = initialPosition + glm::vec3(-14.0f, 5.4f, -150.0f);
 		landingPlaneObj.scale = glm::vec3(0.005f);
 		landingPlaneObj.bounding.center = glm::vec3(0.0f);
@@ -809,7 +811,7 @@ void InitSceneObjects(const glm::vec3& initialPosition)
 	}
 }
 
-int main() 
+int main(int argc, char* argv[]) 
 {
 
 	glfwInit();
@@ -834,7 +836,7 @@ int main()
 
 	glewInit();
 
-	glEnable(GL_DEPTH_TEST);
+	GLState::Get().Enable(GL_DEPTH_TEST);
 
 	float vertices[] = {
 		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
@@ -884,10 +886,10 @@ int main()
 	glGenVertexArrays(1, &cubeVAO);
 	glGenBuffers(1, &VBO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, VBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-	glBindVertexArray(cubeVAO);
+	GLState::Get().BindVertexArray(cubeVAO);
 
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
@@ -896,9 +898,9 @@ int main()
 
 	unsigned int lightVAO;
 	glGenVertexArrays(1, &lightVAO);
-	glBindVertexArray(lightVAO);
+	GLState::Get().BindVertexArray(lightVAO);
 
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, VBO);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
 
@@ -906,16 +908,16 @@ int main()
 	glGenVertexArrays(1, &skyboxVAO);
 	glGenBuffers(1, &skyboxVBO);
 	glGenBuffers(1, &skyboxEBO);
-	glBindVertexArray(skyboxVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+	GLState::Get().BindVertexArray(skyboxVAO);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyboxEBO);
+	GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyboxEBO);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(skyboxIndices), &skyboxIndices, GL_STATIC_DRAW);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindVertexArray(0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	GLState::Get().BindBuffer(GL_ARRAY_BUFFER, 0);
+	GLState::Get().BindVertexArray(0);
+	GLState::Get().BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	glm::vec3 initialPosition(0.0f, 0.0f, 0.0f);
 
@@ -945,28 +947,104 @@ int main()
 	Shader lampShader((currentPath + "\\Shaders\\Lamp.vs").c_str(), (currentPath + "\\Shaders\\Lamp.fs").c_str());
 	Shader skyboxShader((currentPath + "\\PlaneSimulator\\skybox.vs").c_str(), (currentPath + "\\PlaneSimulator\\skybox.fs").c_str());
 	Shader terrainShader((currentPath + "\\PlaneSimulator\\terrain.vs").c_str(), (currentPath + "\\PlaneSimulator\\terrain.fs").c_str());
+	Shader terrainInstancedShader((currentPath + "\\PlaneSimulator\\terrain_instanced.vs").c_str(), (currentPath + "\\PlaneSimulator\\terrain.fs").c_str());
+	Shader heightfieldShader((currentPath + "\\PlaneSimulator\\terrain_heightfield.vs").c_str(), (currentPath + "\\PlaneSimulator\\terrain.fs").c_str());
+	Shader particleShader((currentPath + "\\PlaneSimulator\\particle.vs").c_str(), (currentPath + "\\PlaneSimulator\\particle.fs").c_str());
 	Shader aiportShader((currentPath + "\\PlaneSimulator\\default.vs").c_str(), (currentPath + "\\PlaneSimulator\\default.fs").c_str());
 
-	glm::vec4 lightColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	// Scene models show their textures unlit
+	glm::vec3 lightColor = glm::vec3(1.0f);
 
 	terrainShader.use();
 	terrainShader.SetVec3("lightColor", lightColor);
 	terrainShader.SetVec3("objectColor", glm::vec3(0.f));
 
-	// Models
-	airplane = Model(currentPath + "\\Models\\Airplane\\IAR-93B.obj");
-	parkedAirplane = Model(currentPath + "\\Models\\Parked Plane\\ImageToStl.com_iar_80_romanian_ww_ii_low-wing_monoplane.obj");
-	terrain = Model(currentPath + "\\Models\\Map\\Map.obj");
-	tower = Model(currentPath + "\\Models\\Tower\\Tower_Control.obj");
-	road = Model(currentPath + "\\Models\\Road\\Road.obj");
-	hangare = Model(currentPath + "\\Models\\Hangar\\uploads_files_852157_Shelter_simple.obj");
-	highFlyingAirplane = Model(currentPath + "\\Models\\Airplane\\IAR-93B.obj");
-	highFlyingAirplane2 = Model(currentPath + "\\Models\\Airplane\\IAR-93B.obj");
-	landingPlane = Model(currentPath + "\\Models\\Airplane\\IAR-93B.obj");
-	cloud = Model(currentPath + "\\Models\\Cloud\\Cloud_Polygon_Blender_1.obj");
-	building = Model(currentPath + "\\Models\\Building\\10079_Office Building - Brick_V1_iterations-0.obj");
-
-	unsigned int terrainTexture = CreateTexture(currentPath + "\\Models\\Map\\Map.jpg");
+	terrainInstancedShader.use();
+	terrainInstancedShader.SetVec3("lightColor", lightColor);
+
+	heightfieldShader.use();
+	heightfieldShader.SetVec3("lightColor", lightColor);
+
+	if (argc > 1 && std::string(argv[1]) == "--cook-textures") {
+		CookTextures(currentPath + "\\Models");
+		glfwTerminate();
+		return 0;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--bench-mtl") {
+		std::vector<std::string> mtlPaths;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(currentPath + "\\Models"))
+			if (entry.path().extension() == ".mtl")
+				mtlPaths.push_back(entry.path().string());
+		RunMtlBenchmark(mtlPaths);
+		glfwTerminate();
+		return 0;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--bench-obj") {
+		RunObjBenchmark({
+			currentPath + "\\Models\\Map\\Map.obj",
+			currentPath + "\\Models\\Building\\10079_Office Building - Brick_V1_iterations-0.obj"
+		});
+		glfwTerminate();
+		return 0;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--bench-particles") {
+		RunParticleBenchmark(1000000);
+		glfwTerminate();
+		return 0;
+	}
+
+	if (argc > 1 && std::string(argv[1]) == "--bench-load") {
+		RunLoadBenchmark({
+			currentPath + "\\Models\\Airplane\\IAR-93B.obj",
+			currentPath + "\\Models\\Parked Plane\\ImageToStl.com_iar_80_romanian_ww_ii_low-wing_monoplane.obj",
+			currentPath + "\\Models\\Map\\Map.obj",
+			currentPath + "\\Models\\Tower\\Tower_Control.obj",
+			currentPath + "\\Models\\Road\\Road.obj",
+			currentPath + "\\Models\\Hangar\\uploads_files_852157_Shelter_simple.obj",
+			currentPath + "\\Models\\Cloud\\Cloud_Polygon_Blender_1.obj",
+			currentPath + "\\Models\\Building\\10079_Office Building - Brick_V1_iterations-0.obj"
+		});
+		glfwTerminate();
+		return 0;
+	}
+
+	// Models and textures are imported on the worker pool; Finish() uploads them here on the GL thread
+	AssetLoader loader;
+	loader.LoadModel(currentPath + "\\Models\\Airplane\\IAR-93B.obj", airplane);
+	loader.LoadModel(currentPath + "\\Models\\Parked Plane\\ImageToStl.com_iar_80_romanian_ww_ii_low-wing_monoplane.obj", parkedAirplane);
+	// The map is only read back into a heightfield, so it keeps its CPU copy and skips LODs and meshlets
+	ModelLoadOptions mapOptions;
+	mapOptions.keepCpuData = true;
+	mapOptions.generateLods = false;
+	mapOptions.buildMeshlets = false;
+	loader.LoadModel(currentPath + "\\Models\\Map\\Map.obj", terrain, mapOptions);
+	loader.LoadModel(currentPath + "\\Models\\Tower\\Tower_Control.obj", tower);
+	loader.LoadModel(currentPath + "\\Models\\Road\\Road.obj", road);
+	loader.LoadModel(currentPath + "\\Models\\Hangar\\uploads_files_852157_Shelter_simple.obj", hangare);
+	loader.LoadModel(currentPath + "\\Models\\Airplane\\IAR-93B.obj", highFlyingAirplane);
+	loader.LoadModel(currentPath + "\\Models\\Airplane\\IAR-93B.obj", highFlyingAirplane2);
+	loader.LoadModel(currentPath + "\\Models\\Airplane\\IAR-93B.obj", landingPlane);
+	loader.LoadModel(currentPath + "\\Models\\Cloud\\Cloud_Polygon_Blender_1.obj", cloud);
+	loader.LoadModel(currentPath + "\\Models\\Building\\10079_Office Building - Brick_V1_iterations-0.obj", building);
+
+	loader.Finish();
+	loader.PrintReport();
+	GeometryArena::Get().PrintStats();
+
+	// Map.jpg is large; draws use a placeholder until it has streamed in
+	TextureParams terrainTextureParams;
+	terrainTextureParams.clampAlpha = true;
+	unsigned int terrainTexture = TextureCache::Get().Acquire(currentPath + "\\Models\\Map\\Map.jpg", terrainTextureParams);
+	TextureCache::Get().PrintStats();
+
+	// Both skyboxes are loaded once; the frame loop only picks one by time of day
+	const std::string daySkyboxPath = currentPath + "\\Models\\skybox\\";
+	const std::string nightSkyboxPath = currentPath + "\\Models\\skyboxNight\\";
+	unsigned int daySkybox = LoadSkybox(SkyboxFaces(daySkyboxPath));
+	unsigned int nightSkybox = LoadSkybox(SkyboxFaces(nightSkyboxPath));
 
 	InitSceneObjects(initialPosition);
 
@@ -975,12 +1053,58 @@ int main()
 	glm::vec3 highFlyingAirplanePosition2 = initialPosition + glm::vec3(-26.0f, 8.4f, -200.0f);
 	glm::vec3 landingPLanePosition = highFlyingAirplanePosition + glm::vec3(-14.0f, 5.4f, -150.0f);
 
-	initParticles();
+	// The ground is a heightfield rasterized from the map and drawn as chunks whose detail follows the camera;
+	// the same heightfield answers every height query on the CPU
+	Heightfield heightfield;
+	heightfield.FromMeshes(terrain->meshes, modelTransform(initialPositionTerrain + glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.0f), glm::vec3(0.01f)), 1024);
+	Terrain ground;
+	ground.Create(heightfield);
+	terrain->Release();
+
+	// Eye height of the grounded camera above the terrain, and the closest a flying one may get to it
+	const float groundedEyeHeight = 0.4f;
+	const float minimumFlightClearance = 0.5f;
+
+	// One fixed pool for every effect; each emitter reserves its budget from it.
+	ParticleEffects particleEffects(2048);
+	particleEffects.System().SetGravity(glm::vec3(0.0f, -9.81f, 0.0f));
+	GroundCollision groundContact;
+	groundContact.enabled = true;
+	groundContact.terrain = &heightfield;
+	groundContact.restitution = 0.1f;
+	groundContact.friction = 0.5f;
+	particleEffects.System().SetGroundCollision(groundContact);
+
+	ParticleEmitter* rain = particleEffects.CreateEmitter(RainEmitter());
+	rain->SetPosition(glm::vec3(0.0f, 15.0f, 0.0f));
+	ParticleEmitter* exhaust = particleEffects.CreateEmitter(ExhaustEmitter());
+	ParticleEmitter* touchdownDust = particleEffects.CreateEmitter(TouchdownDustEmitter());
+	bool landingPlaneTouchedDown = false;
+	ParticleRenderer particleRenderer;
 
 	glm::vec3 cloudAreaMin(-400.0f, 160.0f, -2000.0f);
 	glm::vec3 cloudAreaMax(400.0f, 220.0f, -200.0f);
 	initClouds(100, cloudAreaMin, cloudAreaMax);
 
+	// Scenery that never moves is queued once; the queue only refreshes its depth, level of detail and culling each frame.
+	// Moving models are submitted every frame and everything is drawn by the flush.
+	RenderQueue& renderQueue = RenderQueue::Get();
+	renderQueue.AddStatic(sceneObject(terrainShader, *parkedAirplane, modelTransform(glm::vec3(-43.0f, -18.8f, -55.0f), glm::vec3(-90.0f, 20.f, -120.0f), glm::vec3(0.4188f)) * g_parkedPlaneFix));
+	renderQueue.AddStatic(sceneObject(terrainShader, *tower, modelTransform(initialPosition + glm::vec3(-4.0f, -21.4f, -217.0f), glm::vec3(0.0f, 90.0f, 0.0f), glm::vec3(1.3f)), true));
+	renderQueue.AddStatic(sceneObject(terrainShader, *road, modelTransform(initialPosition + glm::vec3(45.0f, -19.5f, -7.0f), glm::vec3(0.0f, 90.0f, 0.0f), glm::vec3(0.7f, 0.3f, 1.0f))));
+	renderQueue.AddStatic(sceneObject(terrainShader, *hangare, modelTransform(initialPosition + glm::vec3(-28.0f, -19.4f, -10.0f), glm::vec3(0.0f), glm::vec3(0.3f)), true));
+	renderQueue.AddStatic(sceneObject(terrainShader, *hangare, modelTransform(initialPosition + glm::vec3(-55.0f, -19.4f, -55.0f), glm::vec3(0.0f, 90.0f, 0.0f), glm::vec3(0.3f)), true));
+
+	// Copies of one model are drawn instanced: the planes as one batch, the clouds as one batch per level of detail
+	InstanceBuffer planeInstances;
+	InstanceBuffer cloudInstances[MaxLodCount];
+	std::vector<glm::mat4> planeTransforms;
+	std::vector<glm::mat4> cloudTransforms[MaxLodCount];
+	// Copies are culled one by one before they are batched; the queue then culls each batch as a whole
+	SphereCuller instanceCuller;
+	std::vector<glm::mat4> cloudCandidates;
+	RenderStats::Get().SetReporting(argc > 1 && std::string(argv[1]) == "--render-stats");
+
 	while (!glfwWindowShouldClose(window)) {
 
 		std::string skyBoxPath = currentPath;
@@ -992,7 +1116,7 @@ int main()
 		if (pCamera->GetPosition().z < -1400.0f)
 			pCamera->SetPosition(glm::vec3(0, 20, 1400.0f));
 
-		updateParticles(deltaTime);
+		TextureStreamer::Get().Update();
 
 		timeOfDay += deltaTime * (24.0f / dayDuration);
 		if (timeOfDay > 24.0f) timeOfDay -= 24.0f;
@@ -1001,34 +1125,24 @@ int main()
 		glm::vec3 skyColor = getSkyColor(timeOfDay, skyBoxPath);
 		float lightIntensity = getLightIntensity(timeOfDay);
 
-		std::vector<std::string> facesCubemap =
-		{
-			skyBoxPath + "px.png",
-			skyBoxPath + "nx.png",
-			skyBoxPath + "py.png",
-			skyBoxPath + "ny.png",
-			skyBoxPath + "pz.png",
-			skyBoxPath + "nz.png"
-		};
-
-		unsigned int cubemapTexture = LoadSkybox(facesCubemap);
+		unsigned int cubemapTexture = skyBoxPath == nightSkyboxPath ? nightSkybox : daySkybox;
 
 		processInput(window);
 		pCamera->UpdateFlight(deltaTime);
 
 		if (pCamera->IsFlying()) {
 			glm::vec3 newVector = pCamera->GetPosition();
-			if (newVector.y <= initialPositionTerrain.y + 11)
+			if (heightfield.RadioAltitude(newVector) <= minimumFlightClearance)
 				newVector.y += 1.0f;
 			pCamera->SetPosition(newVector);
 		}
 		else if (pCamera->IsGrounded()) {
 			glm::vec3 pos = pCamera->GetPosition();
-			pos.y = -19.1f;
+			pos.y = heightfield.HeightAt(pos.x, pos.z) + groundedEyeHeight;
 			pCamera->SetPosition(pos);
 		}
 
-		glEnable(GL_DEPTH_TEST);
+		GLState::Get().Enable(GL_DEPTH_TEST);
 		glClearColor(skyColor.r, skyColor.g, skyColor.b, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glm::vec3 oldPosition = pCamera->GetPosition();
@@ -1054,70 +1168,108 @@ int main()
 		glm::vec3 cameraForward = pCamera->GetForward();
 		glm::vec3 rotationAngles = glm::vec3(pCamera->GetPitch(), pCamera->GetYaw(), pCamera->GetRoll()) + glm::vec3(-90.0f, 90.f, 0.0f);
 
-
-		renderParticles(terrainShader);
+		// Camera and lighting for the whole frame, shared by every program through the FrameData block
+		FrameUniforms frame;
+		frame.view = pCamera->GetViewMatrix();
+		frame.projection = pCamera->GetProjectionMatrix();
+		frame.viewProjection = frame.projection * frame.view;
+		frame.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+		frame.lightPosition = glm::vec4(lightPos, 1.0f);
+		frame.lightColor = glm::vec4(glm::vec3(lightIntensity), 1.0f);
+		frame.skyColor = glm::vec4(skyColor, 1.0f);
+		frame.timeOfDay = glm::vec4(timeOfDay, (float)currentFrame, 0.0f, 0.0f);
+		FrameUniformBuffer::Get().Update(frame);
+		Frustum viewFrustum = Frustum::FromMatrix(frame.viewProjection);
 
 
 		glm::vec3 airplanePosition = cameraPosition + cameraForward + glm::vec3(0.0f, -0.1f, -0.5f);
 		
-		// render planes
-		renderModelPlane(terrainShader, airplane, airplanePosition, /*glm::vec3(0.0f, 180.f, 0.0f)*/rotationAngles, glm::vec3(0.1005f));
-		renderModelParkedPlane(terrainShader, parkedAirplane, glm::vec3(-43.0f, -18.8f, -55.0f), glm::vec3(-90.0f, 20.f, -120.0f), glm::vec3(0.4188f));
+		// submit planes; all four share the IAR-93B model, so one instanced batch draws them
+		planeTransforms.clear();
+		planeTransforms.push_back(modelTransform(airplanePosition, /*glm::vec3(0.0f, 180.f, 0.0f)*/rotationAngles, glm::vec3(0.1005f)) * g_planeFix);
 
 		highFlyingAirplanePosition += glm::vec3(deltaTime * 2.0f, deltaTime, deltaTime);
-		renderModelPlane(terrainShader, highFlyingAirplane, highFlyingAirplanePosition, glm::vec3(-90.0f, 0.f, -90.0f), glm::vec3(0.105f));
+		planeTransforms.push_back(modelTransform(highFlyingAirplanePosition, glm::vec3(-90.0f, 0.f, -90.0f), glm::vec3(0.105f)) * g_planeFix);
 
 		highFlyingAirplanePosition2 += glm::vec3(-2.0f * deltaTime, deltaTime, 2.0f * deltaTime);
-		renderModelPlane(terrainShader, highFlyingAirplane2, highFlyingAirplanePosition2, glm::vec3(-75.0f, 0.f, 45.0f), glm::vec3(0.1015f));
-
-		renderModelPlane(terrainShader, landingPlane, landingPLanePosition, glm::vec3(-90.0f, 0.0f, 180.0f), glm::vec3(0.405f));
-		if (landingPLanePosition.y > -19.5f)
+		planeTransforms.push_back(modelTransform(highFlyingAirplanePosition2, glm::vec3(-75.0f, 0.f, 45.0f), glm::vec3(0.1015f)) * g_planeFix);
+
+		planeTransforms.push_back(modelTransform(landingPLanePosition, glm::vec3(-90.0f, 0.0f, 180.0f), glm::vec3(0.405f)) * g_planeFix);
+
+		cullInstances(instanceCuller, viewFrustum, *airplane, planeTransforms);
+		size_t visiblePlanes = 0;
+		for (size_t i = 0; i < planeTransforms.size(); i++)
+			if (instanceCuller.IsVisible(i))
+				planeTransforms[visiblePlanes++] = planeTransforms[i];
+		planeTransforms.resize(visiblePlanes);
+
+		planeInstances.Upload(planeTransforms);
+		if (!planeTransforms.empty()) {
+			RenderQueue::Object planes = sceneObject(terrainInstancedShader, *airplane, glm::mat4(1.0f));
+			planes.instances = &planeInstances;
+			renderQueue.Submit(planes);
+		}
+		// The landing plane descends until its radio altitude reaches zero, then rolls out along the surface
+		if (heightfield.RadioAltitude(landingPLanePosition) > 0.0f)
 			landingPLanePosition += glm::vec3(0.0f, -0.1f, 1.0f);
 
-		if (landingPLanePosition.y <= -19.5f && landingPLanePosition.z < -45.0f)
+		bool landingPlaneOnGround = heightfield.RadioAltitude(landingPLanePosition) <= 0.0f;
+		if (landingPlaneOnGround && landingPLanePosition.z < -45.0f)
 			landingPLanePosition += glm::vec3(0.0f, 0.0f, 0.5f);
 
-		if (landingPLanePosition.y <= -19.5f && landingPLanePosition.z < -40.0f && landingPLanePosition.z > -45.5f)
+		if (landingPlaneOnGround && landingPLanePosition.z < -40.0f && landingPLanePosition.z > -45.5f)
 			landingPLanePosition += glm::vec3(0.0f, 0.0f, 0.25f);
 
-		if (landingPLanePosition.y <= -19.5f && landingPLanePosition.z < -35.0f && landingPLanePosition.z > -40.5f)
+		if (landingPlaneOnGround && landingPLanePosition.z < -35.0f && landingPLanePosition.z > -40.5f)
 			landingPLanePosition += glm::vec3(0.0f, 0.0f, 0.1f);
 
-		// render turn
-		renderModel(terrainShader, tower, initialPosition + glm::vec3(-4.0f, -21.4f, -217.0f), 90.0f, glm::vec3(1.3f));
-
-		renderModel(terrainShader, road, initialPosition + glm::vec3(45.0f, -19.5f, -7.0f), 90.0f, glm::vec3(0.7f, 0.3f, 1.0f));
-
-		renderModel(terrainShader, hangare, initialPosition + glm::vec3(-28.0f, -19.4f, -10.0f), 0.0f, glm::vec3(0.3f));
-
-
-		// render teren
-		renderTerrain(terrainShader, terrain, initialPositionTerrain + glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.01), terrainTexture);
-
-		renderModel(terrainShader, hangare, initialPosition + glm::vec3(-55.0f, -19.4f, -55.0f), glm::vec3(0.0f, 90.0f, 0.0f), glm::vec3(0.3f));
-
-
-		for (const auto& cloud1 : clouds) {
-			renderModel(terrainShader, cloud, initialPosition + cloud1.position, glm::vec3(0.0f, cloud1.rotation, 0.0f), cloud1.scale);
+		if (landingPlaneOnGround)
+			landingPLanePosition.y = heightfield.HeightAt(landingPLanePosition.x, landingPLanePosition.z);
+
+		// Effects follow the planes: exhaust thickens with the player's speed, dust rises once where the landing plane touches down.
+		exhaust->SetPosition(airplanePosition);
+		exhaust->SetVelocity(cameraForward * pCamera->GetSpeed() * 10.0f);
+		exhaust->SetRateScale(0.2f + pCamera->GetSpeed() / 10.0f);
+		if (!landingPlaneTouchedDown && landingPlaneOnGround) {
+			landingPlaneTouchedDown = true;
+			touchdownDust->SetPosition(landingPLanePosition);
+			touchdownDust->Burst(touchdownDust->Settings().budget);
 		}
+		particleEffects.Update(deltaTime);
+
+		// Clouds out of view skip level of detail selection and keep last frame's level
+		for (auto& transforms : cloudTransforms)
+			transforms.clear();
+		cloudCandidates.clear();
+		for (auto& cloud1 : clouds)
+			cloudCandidates.push_back(modelTransform(initialPosition + cloud1.position, glm::vec3(0.0f, cloud1.rotation, 0.0f), cloud1.scale));
+		cullInstances(instanceCuller, viewFrustum, *cloud, cloudCandidates);
+		for (size_t i = 0; i < clouds.size(); i++) {
+			if (!instanceCuller.IsVisible(i))
+				continue;
+			Cloud& cloud1 = clouds[i];
+			cloud1.lod = cloud->SelectLod(cloudCandidates[i], frame.view, frame.projection, (float)pCamera->GetHeight(), cloud1.lod);
+			cloudTransforms[std::min(cloud1.lod, int(MaxLodCount) - 1)].push_back(cloudCandidates[i]);
+		}
+		for (int level = 0; level < int(MaxLodCount); level++) {
+			cloudInstances[level].Upload(cloudTransforms[level]);
+			if (cloudTransforms[level].empty())
+				continue;
+			RenderQueue::Object cloudBatch = sceneObject(terrainInstancedShader, *cloud, glm::mat4(1.0f));
+			cloudBatch.instances = &cloudInstances[level];
+			cloudBatch.lod = level;
+			renderQueue.Submit(cloudBatch);
+		}
+		ground.Draw(heightfieldShader, terrainTexture, frame.view, frame.projection, (float)pCamera->GetHeight());
+		renderQueue.Flush((float)pCamera->GetHeight());
 		for (auto& cloud : clouds) {
 			cloud.position.z += cloud.speed * deltaTime;
 		}
 
 
 		lightingShader.SetVec3("objectColor", 0.5f, 1.0f, 0.31f);
-		lightingShader.SetVec3("lightColor", glm::vec3(lightIntensity)); 
-		lightingShader.SetVec3("lightPos", lightPos);
-		lightingShader.SetVec3("viewPos", pCamera->GetPosition());
-		lightingShader.setMat4("projection", pCamera->GetProjectionMatrix());
-		lightingShader.setMat4("view", pCamera->GetViewMatrix());
-
-		glm::mat4 projection = pCamera->GetProjectionMatrix();
-		glm::mat4 view = pCamera->GetViewMatrix();
 
 		lampShader.use();
-		lampShader.setMat4("projection", projection);
-		lampShader.setMat4("view", view);
 
 		glm::mat4 lightModel = glm::mat4(1.0f);
 		lightModel = glm::translate(lightModel, glm::vec3(0.0f, 50.0f, 0.0f)); 
@@ -1125,43 +1277,45 @@ int main()
 
 		lampShader.setMat4("model", lightModel);
 
-		glBindVertexArray(lightVAO);
+		GLState::Get().BindVertexArray(lightVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 36);
-		glBindVertexArray(0);
-
-		glBindTexture(GL_TEXTURE_2D, 0);
 
 		//render skybox
-		glDepthFunc(GL_LEQUAL);
+		GLState::Get().DepthFunc(GL_LEQUAL);
 		skyboxShader.use();
-		projection = pCamera->GetProjectionMatrix();
-		view = glm::mat4(glm::mat3(pCamera->GetViewMatrix()));
-		skyboxShader.setMat4("projection", projection);
-		skyboxShader.setMat4("view", view);
-
 		skyboxShader.setVec3("skyColor", skyColor);
 
-		glBindVertexArray(skyboxVAO);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+		GLState::Get().BindVertexArray(skyboxVAO);
+		GLState::Get().BindTexture(0, GL_TEXTURE_CUBE_MAP, cubemapTexture);
 		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-		glDepthFunc(GL_LESS);
+		GLState::Get().DepthFunc(GL_LESS);
 
-		glBindVertexArray(lightVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 36);
+		// Blended, so after everything opaque including the sky
+		renderParticles(particleEffects, particleRenderer, particleShader);
 
+		RenderStats::Get().EndFrame(currentFrame);
 		glfwSwapBuffers(window);
 		glfwPollEvents();
 	}
 
 	Cleanup();
-
-	glDeleteVertexArrays(1, &cubeVAO);
-	glDeleteVertexArrays(1, &lightVAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteVertexArrays(1, &skyboxVAO);
-	glDeleteBuffers(1, &skyboxVBO);
+	TextureStreamer::Get().Shutdown();
+	GeometryArena::Get().Shutdown();
+	FrameUniformBuffer::Get().Shutdown();
+	planeInstances.Release();
+	particleRenderer.Release();
+	ground.Release();
+	for (auto& instances : cloudInstances)
+		instances.Release();
+
+	TextureCache::Get().Release(terrainTexture);
+	GLState::Get().DeleteTextures(1, &daySkybox);
+	GLState::Get().DeleteTextures(1, &nightSkybox);
+	GLState::Get().DeleteVertexArrays(1, &cubeVAO);
+	GLState::Get().DeleteVertexArrays(1, &lightVAO);
+	GLState::Get().DeleteBuffers(1, &VBO);
+	GLState::Get().DeleteVertexArrays(1, &skyboxVAO);
+	GLState::Get().DeleteBuffers(1, &skyboxVBO);
 
 	glfwTerminate();
 	return 0;
@@ -1205,32 +1359,7 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yOffset)
 	pCamera->ProcessMouseScroll((float)yOffset);
 }
 
-void renderModel(Shader& ourShader, Model& ourModel, const glm::vec3& position, float rotationAngle, const glm::vec3& scale)
-{
-
-	ourShader.use();
-	ourShader.SetVec3("objectColor", glm::vec3(0.0f));
-
-
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, position);
-	model = glm::rotate(model, glm::radians(rotationAngle), glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::scale(model, scale);
-
-	glm::mat4 viewMatrix = pCamera->GetViewMatrix();
-	glm::mat4 projectionMatrix = pCamera->GetProjectionMatrix();
-
-	ourShader.setMat4("model", model);
-	ourShader.setMat4("view", viewMatrix);
-	ourShader.setMat4("projection", projectionMatrix);
-
-	ourModel.Draw(ourShader);
-}
-
-void renderModel(Shader& ourShader, Model& ourModel, const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale) {
-	ourShader.use();
-	ourShader.SetVec3("objectColor", glm::vec3(0.0f));
-
+glm::mat4 modelTransform(const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale) {
 	glm::mat4 model = glm::mat4(1.0f);
 	model = glm::translate(model, position);
 
@@ -1238,87 +1367,27 @@ void renderModel(Shader& ourShader, Model& ourModel, const glm::vec3& position,
 	model = glm::rotate(model, glm::radians(rotationAngles.y), glm::vec3(0.0f, 1.0f, 0.0f)); // Rotation around Y axis
 	model = glm::rotate(model, glm::radians(rotationAngles.z), glm::vec3(0.0f, 0.0f, 1.0f)); // Rotation around Z axis
 
-	model = glm::scale(model, scale);
-
-	glm::mat4 viewMatrix = pCamera->GetViewMatrix();
-	glm::mat4 projectionMatrix = pCamera->GetProjectionMatrix();
-
-	ourShader.setMat4("model", model);
-	ourShader.setMat4("view", viewMatrix);
-	ourShader.setMat4("projection", projectionMatrix);
-
-	ourModel.Draw(ourShader);
-}
-
-void renderModelPlane(Shader& ourShader, Model& ourModel, const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale) {
-	ourShader.use();
-	ourShader.SetVec3("objectColor", glm::vec3(0.0f));
-
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, position);
-
-	model = glm::rotate(model, glm::radians(rotationAngles.x), glm::vec3(1.0f, 0.0f, 0.0f)); 
-	model = glm::rotate(model, glm::radians(rotationAngles.y), glm::vec3(0.0f, 1.0f, 0.0f)); 
-	model = glm::rotate(model, glm::radians(rotationAngles.z), glm::vec3(0.0f, 0.0f, 1.0f)); 
-
-	model = glm::scale(model, scale);
-
-	glm::mat4 viewMatrix = pCamera->GetViewMatrix();
-	glm::mat4 projectionMatrix = pCamera->GetProjectionMatrix();
-
-	model = model * g_planeFix;
-
-	ourShader.setMat4("model", model);
-	ourShader.setMat4("view", viewMatrix);
-	ourShader.setMat4("projection", projectionMatrix);
-
-	ourModel.Draw(ourShader);
+	return glm::scale(model, scale);
 }
 
-void renderModelParkedPlane(Shader& ourShader, Model& ourModel, const glm::vec3& position, const glm::vec3& rotationAngles, const glm::vec3& scale) {
-	ourShader.use();
-	ourShader.SetVec3("objectColor", glm::vec3(0.0f));
-
-	glm::mat4 model = glm::mat4(1.0f);
-	model = glm::translate(model, position);
-
-	model = glm::rotate(model, glm::radians(rotationAngles.x), glm::vec3(1.0f, 0.0f, 0.0f)); 
-	model = glm::rotate(model, glm::radians(rotationAngles.y), glm::vec3(0.0f, 1.0f, 0.0f)); 
-	model = glm::rotate(model, glm::radians(rotationAngles.z), glm::vec3(0.0f, 0.0f, 1.0f)); 
-
-	model = glm::scale(model, scale);
-
-	glm::mat4 viewMatrix = pCamera->GetViewMatrix();
-	glm::mat4 projectionMatrix = pCamera->GetProjectionMatrix();
-
-	model = model * g_parkedPlaneFix;
-
-	ourShader.setMat4("model", model);
-	ourShader.setMat4("view", viewMatrix);
-	ourShader.setMat4("projection", projectionMatrix);
-
-	ourModel.Draw(ourShader);
+RenderQueue::Object sceneObject(Shader& shader, Model& model, const glm::mat4& transform, bool selectLod) {
+	RenderQueue::Object object;
+	object.shader = &shader;
+	object.model = &model;
+	object.transform = transform;
+	object.selectLod = selectLod;
+	return object;
 }
 
-void renderTerrain(Shader& terrainShader, Model& terrainModel, const glm::vec3& position, const glm::vec3& scale, int terrainTexture) {
-	glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-	model = glm::scale(model, scale);
-	terrainShader.use();
-	terrainShader.setMat4("model", model);
-	terrainShader.setMat4("view", pCamera->GetViewMatrix());
-	terrainShader.setMat4("projection", pCamera->GetProjectionMatrix());
-	glBindTexture(GL_TEXTURE_2D, terrainTexture);
-
-	int gridWidth = 10;
-	int gridDepth = 10;
-
-	for (int x = 0; x < gridWidth; x++) {
-		for (int z = 0; z < gridDepth; z++) {
-			glm::vec3 pos = position + glm::vec3(x * scale.x * 2.0f, 0.0f, z * scale.z * 2.0f); 
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), pos);
-			model = glm::scale(model, scale);
-			terrainShader.setMat4("model", model);
-			terrainModel.Draw(terrainShader);
-		}
+// Tests one bounding sphere per transform of model; the results are read with culler.IsVisible(i).
+void cullInstances(SphereCuller& culler, const Frustum& frustum, const Model& model, const std::vector<glm::mat4>& transforms) {
+	culler.Clear();
+	for (const glm::mat4& transform : transforms) {
+		glm::vec3 center = model.BoundsCenter();
+		float radius = model.BoundsRadius();
+		TransformSphere(transform, center, radius);
+		culler.Add(center, radius);
 	}
-}
\ No newline at end of file
+	size_t visible = culler.Cull(frustum);
+	RenderStats::Get().AddObjects(visible, transforms.size() - visible);
+}
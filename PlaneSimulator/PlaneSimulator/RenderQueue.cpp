@@ -0,0 +1,275 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+#include "FrameData.h"
+#include "GLState.h"
+#include "RenderStats.h"
+
+namespace
+{
+    const int PassShift = 62;
+    const int DepthBits = 22;
+    const int StateBits = 40;
+    const uint64_t DepthMask = (uint64_t(1) << DepthBits) - 1;
+
+    // Distances past this all sort as equally far; well beyond the camera's far plane.
+    const float MaxSortDistance = 4096.0f;
+
+    // program:10 | texture:16 | mesh:14
+    uint64_t stateBits(const Shader& shader, GLuint texture, const Mesh& mesh)
+    {
+        uint64_t program = shader.ID & 0x3FF;
+        uint64_t textureId = texture & 0xFFFF;
+        // The arena format picks the VAO, so it leads; the rest separates meshes sharing one.
+        uint64_t meshId = (uint64_t(mesh.Format()) << 12) | ((reinterpret_cast<uintptr_t>(&mesh) >> 4) & 0xFFF);
+        return (program << 30) | (textureId << 14) | (meshId & 0x3FFF);
+    }
+
+    uint64_t quantizeDepth(float distance)
+    {
+        float t = std::min(std::max(distance / MaxSortDistance, 0.0f), 1.0f);
+        return uint64_t(t * float(DepthMask));
+    }
+
+    uint64_t makeKey(RenderPass pass, uint64_t state, uint64_t depth)
+    {
+        uint64_t key = uint64_t(pass) << PassShift;
+        if (pass == RenderPass::Opaque)
+            return key | (state << DepthBits) | depth;
+        return key | ((DepthMask - depth) << StateBits) | state;
+    }
+}
+
+RenderQueue& RenderQueue::Get()
+{
+    static RenderQueue instance;
+    return instance;
+}
+
+RenderObjectId RenderQueue::AddStatic(const Object& object)
+{
+    Instance added;
+    added.object = object;
+    added.lod = object.lod;
+    statics.push_back(added);
+    staticDirty = true;
+    return RenderObjectId(statics.size() - 1);
+}
+
+void RenderQueue::RemoveStatic(RenderObjectId id)
+{
+    if (id >= statics.size())
+        return;
+    statics[id].alive = false;
+    staticDirty = true;
+}
+
+void RenderQueue::ClearStatic()
+{
+    statics.clear();
+    staticPackets.clear();
+    staticDirty = false;
+}
+
+void RenderQueue::Submit(const Object& object, int* lod)
+{
+    Instance submitted;
+    submitted.object = object;
+    submitted.lod = lod && object.selectLod ? *lod : object.lod;
+    dynamics.push_back(submitted);
+    dynamicLods.push_back(lod);
+}
+
+RenderQueue::Instance& RenderQueue::instance(uint32_t index)
+{
+    return index < statics.size() ? statics[index] : dynamics[index - statics.size()];
+}
+
+void RenderQueue::appendPackets(const Instance& instance, uint32_t index, std::vector<Packet>& target) const
+{
+    const Object& object = instance.object;
+    if (!object.shader || !object.model)
+        return;
+
+    for (uint32_t i = 0; i < object.model->meshes.size(); i++)
+    {
+        const Mesh& mesh = object.model->meshes[i];
+        GLuint texture = object.texture;
+        if (!texture && !mesh.textures.empty())
+            texture = mesh.textures[0].id;
+
+        Packet packet;
+        packet.state = stateBits(*object.shader, texture, mesh);
+        packet.key = 0;
+        packet.instance = index;
+        packet.mesh = i;
+        target.push_back(packet);
+    }
+}
+
+void RenderQueue::rebuildStaticPackets()
+{
+    staticPackets.clear();
+    for (uint32_t i = 0; i < statics.size(); i++)
+    {
+        if (statics[i].alive)
+            appendPackets(statics[i], i, staticPackets);
+    }
+    staticDirty = false;
+}
+
+void RenderQueue::prepare(Instance& instance, float viewportHeight, bool cullBackfaces)
+{
+    const FrameUniforms& frame = FrameUniformBuffer::Get().Current();
+    const Object& object = instance.object;
+    if (!object.model || object.instances)
+        return;
+
+    if (object.selectLod)
+        instance.lod = object.model->SelectLod(object.transform, frame.view, frame.projection, viewportHeight, instance.lod);
+    if (object.cullMeshlets)
+        instance.cull = MeshletCullView::FromMatrices(object.transform, frame.view, frame.projection, cullBackfaces);
+}
+
+void RenderQueue::addBounds(const Instance& instance)
+{
+    const Object& object = instance.object;
+    if (!instance.alive || !object.model || !object.shader)
+    {
+        culler.Add(glm::vec3(0.0f), -1.0f);
+        return;
+    }
+
+    const Model& model = *object.model;
+    if (object.instances)
+    {
+        // Every copy lies within the spread of the positions plus the largest scaled model.
+        float modelReach = glm::length(model.BoundsCenter()) + model.BoundsRadius();
+        culler.Add(object.instances->Center(), object.instances->Spread() + object.instances->MaxScale() * modelReach);
+        return;
+    }
+
+    glm::vec3 center = model.BoundsCenter();
+    float radius = model.BoundsRadius();
+    TransformSphere(object.transform, center, radius);
+    culler.Add(center, radius);
+}
+
+void RenderQueue::Flush(float viewportHeight)
+{
+    if (staticDirty)
+        rebuildStaticPackets();
+
+    culler.Clear();
+    for (const Instance& object : statics)
+        addBounds(object);
+    for (const Instance& object : dynamics)
+        addBounds(object);
+    culler.Cull(Frustum::FromMatrix(FrameUniformBuffer::Get().Current().viewProjection));
+
+    // Instanced batches are left out of the stats; their copies are counted by whoever culls them one by one.
+    size_t visible = 0, culled = 0;
+    for (uint32_t i = 0; i < uint32_t(statics.size() + dynamics.size()); i++)
+    {
+        const Instance& counted = instance(i);
+        if (!counted.alive || !counted.object.model || !counted.object.shader || counted.object.instances)
+            continue;
+        if (culler.IsVisible(i))
+            visible++;
+        else
+            culled++;
+    }
+    RenderStats::Get().AddObjects(visible, culled);
+
+    const bool cullBackfaces = GLState::Get().IsEnabled(GL_CULL_FACE);
+    for (uint32_t i = 0; i < statics.size(); i++)
+    {
+        if (culler.IsVisible(i))
+            prepare(statics[i], viewportHeight, cullBackfaces);
+    }
+    for (uint32_t i = 0; i < dynamics.size(); i++)
+    {
+        // Out of view, the level an object had last frame is kept.
+        if (!culler.IsVisible(statics.size() + i))
+            continue;
+        prepare(dynamics[i], viewportHeight, cullBackfaces);
+        if (dynamicLods[i] && dynamics[i].object.selectLod)
+            *dynamicLods[i] = dynamics[i].lod;
+    }
+
+    packets.clear();
+    for (const Packet& packet : staticPackets)
+    {
+        if (culler.IsVisible(packet.instance))
+            packets.push_back(packet);
+    }
+    for (uint32_t i = 0; i < dynamics.size(); i++)
+    {
+        uint32_t index = uint32_t(statics.size()) + i;
+        if (culler.IsVisible(index))
+            appendPackets(dynamics[i], index, packets);
+    }
+
+    const glm::vec3 camera = glm::vec3(FrameUniformBuffer::Get().Current().cameraPosition);
+    for (Packet& packet : packets)
+    {
+        const Object& object = instance(packet.instance).object;
+        const Mesh& mesh = object.model->meshes[packet.mesh];
+        glm::vec3 center = object.instances ? object.instances->Center() : glm::vec3(object.transform * glm::vec4(mesh.BoundsCenter(), 1.0f));
+        packet.key = makeKey(object.pass, packet.state, quantizeDepth(glm::distance(center, camera)));
+    }
+    std::sort(packets.begin(), packets.end(), [](const Packet& a, const Packet& b) { return a.key < b.key; });
+
+    static constexpr UniformName ModelMatrix("model");
+    GLState& state = GLState::Get();
+    GeometryArena& arena = GeometryArena::Get();
+    uint32_t lastInstance = UINT32_MAX;
+    const Shader* lastShader = nullptr;
+    bool blending = false;
+    for (const Packet& packet : packets)
+    {
+        Instance& drawn = instance(packet.instance);
+        const Object& object = drawn.object;
+
+        bool transparent = object.pass == RenderPass::Transparent;
+        if (transparent != blending)
+        {
+            blending = transparent;
+            state.SetEnabled(GL_BLEND, blending);
+            state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            state.DepthMask(!blending);
+        }
+
+        object.shader->use();
+        if (object.texture)
+            state.BindTexture(0, GL_TEXTURE_2D, object.texture);
+
+        Mesh& mesh = object.model->meshes[packet.mesh];
+        if (object.instances)
+        {
+            arena.BindInstanced(mesh.Format(), object.instances->Buffer());
+            mesh.DrawInstancedBound(*object.shader, object.instances->Count(), drawn.lod);
+            continue;
+        }
+
+        // Meshes of one object are mostly adjacent, so the matrix goes up once per object.
+        if (packet.instance != lastInstance || object.shader != lastShader)
+        {
+            object.shader->setMat4(ModelMatrix, object.transform);
+            lastInstance = packet.instance;
+            lastShader = object.shader;
+        }
+        arena.Bind(mesh.Format());
+        mesh.DrawBound(*object.shader, drawn.lod, object.cullMeshlets ? &drawn.cull : nullptr);
+    }
+
+    if (blending)
+    {
+        state.Disable(GL_BLEND);
+        state.DepthMask(true);
+    }
+
+    dynamics.clear();
+    dynamicLods.clear();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "InstanceBuffer.h"
+#include "Meshlets.h"
+#include "Model.h"
+#include "Shader.h"
+#include "SphereCuller.h"
+
+enum class RenderPass : uint8_t
+{
+    Opaque = 0,
+    // Blended over the opaque pass, back to front, without depth writes.
+    Transparent = 1,
+};
+
+// Handle of a static object, valid until RemoveStatic or ClearStatic.
+typedef uint32_t RenderObjectId;
+
+// Collects the frame's draws as packets (one per mesh of a placed model),
+// sorts them by a 64-bit key and executes them in that order, so consecutive
+// draws share program, textures and VAO wherever the order allows and GLState
+// drops the binds. Key layout, most significant bits first:
+//
+//   opaque:      pass:2 | program:10 | texture:16 | mesh:14 | depth:22
+//   transparent: pass:2 | far-to-near depth:22 | program:10 | texture:16 | mesh:14
+//
+// Opaque draws batch by state and go front to back within a batch; blended
+// draws need strict back-to-front order, so depth leads. The fields are
+// truncated ids, so a collision costs a state change, never a wrong draw.
+// Before any of that, every object's bounding sphere (a whole instanced batch
+// counts as one) is frustum tested in one SIMD pass, and objects out of view
+// get no packets, level of detail or meshlet work. GL thread only.
+class RenderQueue
+{
+public:
+    struct Object
+    {
+        Shader* shader = nullptr;
+        Model* model = nullptr;
+        glm::mat4 transform = glm::mat4(1.0f);
+        // Bound to texture unit 0 before the meshes bind their own; 0 for none.
+        GLuint texture = 0;
+        RenderPass pass = RenderPass::Opaque;
+        // Pick the level of detail every frame with Model::SelectLod; otherwise draw lod.
+        bool selectLod = false;
+        int lod = 0;
+        // Draw only the on-screen meshlets of full-detail meshes.
+        bool cullMeshlets = true;
+        // Draw one copy per transform in the buffer (Model::DrawInstanced) instead
+        // of one at transform; the shader must be an instanced variant. Instanced
+        // objects always draw lod and are not meshlet culled.
+        const InstanceBuffer* instances = nullptr;
+    };
+
+    static RenderQueue& Get();
+
+    // Static objects stay queued across frames. Their packets are built once
+    // and only rebuilt after the set changes; each frame just refreshes depth,
+    // level of detail and the cull view.
+    RenderObjectId AddStatic(const Object& object);
+    void RemoveStatic(RenderObjectId id);
+    void ClearStatic();
+
+    // Queues an object for the current frame only. With selectLod, lod carries
+    // the level the object was drawn with last frame in and the one picked now
+    // out, so the LOD hysteresis works across frames.
+    void Submit(const Object& object, int* lod = nullptr);
+
+    // Culls, sorts and draws everything queued with the camera of the last
+    // FrameUniformBuffer::Update, then forgets this frame's submissions.
+    void Flush(float viewportHeight);
+
+private:
+    RenderQueue() = default;
+
+    struct Instance
+    {
+        Object object;
+        int lod = 0;
+        MeshletCullView cull;
+        bool alive = true;
+    };
+
+    struct Packet
+    {
+        uint64_t key;
+        // Program, texture and mesh fields, already in place for an opaque key.
+        uint64_t state;
+        // Statics first, then this frame's submissions.
+        uint32_t instance;
+        uint32_t mesh;
+    };
+
+    Instance& instance(uint32_t index);
+    void appendPackets(const Instance& instance, uint32_t index, std::vector<Packet>& target) const;
+    void prepare(Instance& instance, float viewportHeight, bool cullBackfaces);
+    // Adds the object's world bounding sphere to the culler, or one that is never visible.
+    void addBounds(const Instance& instance);
+    void rebuildStaticPackets();
+
+    std::vector<Instance> statics;
+    std::vector<Packet> staticPackets;
+    bool staticDirty = false;
+
+    std::vector<Instance> dynamics;
+    std::vector<int*> dynamicLods;
+    std::vector<Packet> packets;
+    // Statics first, then this frame's submissions, as in Packet::instance.
+    SphereCuller culler;
+};
@@ -0,0 +1,68 @@
+#include "RenderStats.h"
+
+#include <iostream>
+
+namespace
+{
+    const double ReportInterval = 1.0;
+}
+
+RenderStats& RenderStats::Get()
+{
+    static RenderStats instance;
+    return instance;
+}
+
+void RenderStats::AddDraw(size_t triangles, size_t fullDetailTriangles)
+{
+    current.drawCalls++;
+    current.triangles += triangles;
+    current.fullDetailTriangles += fullDetailTriangles;
+}
+
+void RenderStats::AddMeshlets(size_t visible, size_t culled)
+{
+    current.meshletsVisible += visible;
+    current.meshletsCulled += culled;
+}
+
+void RenderStats::AddObjects(size_t visible, size_t culled)
+{
+    current.objectsVisible += visible;
+    current.objectsCulled += culled;
+}
+
+void RenderStats::EndFrame(double time)
+{
+    accumulated.drawCalls += current.drawCalls;
+    accumulated.triangles += current.triangles;
+    accumulated.fullDetailTriangles += current.fullDetailTriangles;
+    accumulated.meshletsVisible += current.meshletsVisible;
+    accumulated.meshletsCulled += current.meshletsCulled;
+    accumulated.objectsVisible += current.objectsVisible;
+    accumulated.objectsCulled += current.objectsCulled;
+    accumulated.stateCalls += current.stateCalls;
+    accumulated.stateCallsSkipped += current.stateCallsSkipped;
+    accumulated.particles += current.particles;
+    accumulated.particleCapacity = current.particleCapacity;
+    frames++;
+    current = Frame();
+
+    if (time - lastReport < ReportInterval)
+        return;
+
+    if (reporting && lastReport > 0.0)
+    {
+        double saved = accumulated.fullDetailTriangles ? 100.0 * (1.0 - double(accumulated.triangles) / accumulated.fullDetailTriangles) : 0.0;
+        std::cout << "RENDER::" << frames / (time - lastReport) << " fps, " << accumulated.drawCalls / frames << " draws, "
+            << accumulated.triangles / frames << " triangles per frame (" << accumulated.fullDetailTriangles / frames
+            << " at full detail, " << int(saved) << "% saved by LOD and culling), objects "
+            << accumulated.objectsVisible / frames << " visible / " << accumulated.objectsCulled / frames << " culled, meshlets "
+            << accumulated.meshletsVisible / frames << " visible / " << accumulated.meshletsCulled / frames << " culled, GL state calls "
+            << accumulated.stateCalls / frames << " issued / " << accumulated.stateCallsSkipped / frames << " skipped, particles "
+            << accumulated.particles / frames << " / " << accumulated.particleCapacity << std::endl;
+    }
+    accumulated = Frame();
+    frames = 0;
+    lastReport = time;
+}
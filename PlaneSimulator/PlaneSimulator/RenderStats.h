@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts what the renderer submits each frame, and how much level-of-detail
+// selection and meshlet culling saved against drawing everything at full
+// detail. GL thread only.
+class RenderStats
+{
+public:
+    struct Frame
+    {
+        size_t drawCalls = 0;
+        size_t triangles = 0;
+        // What triangles would have been with every mesh at LOD 0 and nothing culled.
+        size_t fullDetailTriangles = 0;
+        size_t meshletsVisible = 0;
+        size_t meshletsCulled = 0;
+        // Single objects and instanced copies whose bounding sphere was tested against the frustum; batches are not counted.
+        size_t objectsVisible = 0;
+        size_t objectsCulled = 0;
+        // State changes sent to the driver, and those GLState found redundant.
+        size_t stateCalls = 0;
+        size_t stateCallsSkipped = 0;
+        // Live particles and the size of the pool they come from.
+        size_t particles = 0;
+        size_t particleCapacity = 0;
+    };
+
+    static RenderStats& Get();
+
+    void AddDraw(size_t triangles, size_t fullDetailTriangles);
+    void AddMeshlets(size_t visible, size_t culled);
+    void AddObjects(size_t visible, size_t culled);
+    void AddStateCall(bool skipped) { skipped ? current.stateCallsSkipped++ : current.stateCalls++; }
+    void SetParticles(size_t live, size_t capacity) { current.particles = live; current.particleCapacity = capacity; }
+    // Closes the current frame; with reporting on, prints the per-frame averages about once a second.
+    void EndFrame(double time);
+    void SetReporting(bool enabled) { reporting = enabled; }
+
+    // Counters of the frame being recorded.
+    const Frame& Current() const { return current; }
+
+private:
+    RenderStats() = default;
+
+    Frame current;
+    Frame accumulated;
+    size_t frames = 0;
+    double lastReport = 0.0;
+    bool reporting = false;
+};
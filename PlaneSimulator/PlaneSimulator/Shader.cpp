@@ -1,5 +1,10 @@
 #include "Shader.h"
 
+#include <algorithm>
+
+#include "FrameData.h"
+#include "GLState.h"
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
 {
 
@@ -53,50 +58,176 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    reflectUniforms();
 }
 
 void Shader::use()
 {
-    glUseProgram(ID);
+    GLState::Get().UseProgram(ID);
+}
+
+void Shader::setBool(UniformName name, bool value) const
+{
+    glUniform1i(Location(name), (int)value);
+}
+
+void Shader::setInt(UniformName name, int value)
+{
+    int index = findIndex(name);
+    if (index < 0)
+        return;
+    Uniform& uniform = uniforms[index];
+    if (uniform.unit >= 0)
+        uniform.unit = value;
+    glUniform1i(uniform.location, value);
+}
+
+void Shader::setFloat(UniformName name, float value) const
+{
+    glUniform1f(Location(name), value);
 }
 
-void Shader::setBool(const std::string& name, bool value) const
+void Shader::setMat4(UniformName name, const glm::mat4& mat) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniformMatrix4fv(Location(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setInt(const std::string& name, int value) const
+void Shader::SetVec3(UniformName name, const glm::vec3& value) const
 {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+   glUniform3fv(Location(name), 1, &value[0]);
+}
+void Shader::SetVec3(UniformName name, float x, float y, float z) const
+{
+   glUniform3f(Location(name), x, y, z);
 }
 
-void Shader::setFloat(const std::string& name, float value) const
+void Shader::SetVec4(UniformName name, const glm::vec4& value) const
 {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+   glUniform4fv(Location(name), 1, &value[0]);
 }
 
-void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
+void Shader::SetVec4(UniformName name, float x, float y, float z, float w) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+   glUniform4f(Location(name), x, y, z, w);
 }
 
-void Shader::SetVec3(const std::string& name, const glm::vec3& value) const
+GLint Shader::Location(UniformName name) const
 {
-   glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    int index = findIndex(name);
+    return index >= 0 ? uniforms[index].location : -1;
 }
-void Shader::SetVec3(const std::string& name, float x, float y, float z) const
+
+int Shader::SamplerUnit(UniformName name) const
 {
-   glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    int index = findIndex(name);
+    return index >= 0 ? uniforms[index].unit : -1;
 }
 
-void Shader::SetVec4(const std::string& name, const glm::vec4& value) const
+int Shader::findIndex(UniformName name) const
 {
-   glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    auto it = std::lower_bound(uniforms.begin(), uniforms.end(), name.hash,
+        [](const Uniform& uniform, uint32_t hash) { return uniform.hash < hash; });
+    return it != uniforms.end() && it->hash == name.hash ? int(it - uniforms.begin()) : -1;
 }
 
-void Shader::SetVec4(const std::string& name, float x, float y, float z, float w) const
+namespace
 {
-   glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    bool isSamplerType(GLenum type)
+    {
+        switch (type)
+        {
+        case GL_SAMPLER_1D: case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_1D_SHADOW: case GL_SAMPLER_2D_SHADOW: case GL_SAMPLER_CUBE_SHADOW:
+        case GL_SAMPLER_1D_ARRAY: case GL_SAMPLER_2D_ARRAY: case GL_SAMPLER_2D_ARRAY_SHADOW:
+        case GL_SAMPLER_2D_MULTISAMPLE: case GL_SAMPLER_BUFFER: case GL_SAMPLER_2D_RECT:
+        case GL_INT_SAMPLER_2D: case GL_UNSIGNED_INT_SAMPLER_2D:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+void Shader::reflectUniforms()
+{
+    uniforms.clear();
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> name(std::max(maxLength, 1));
+    // Names only matter for reporting a collision; indices match uniforms until it is sorted.
+    std::vector<std::string> names;
+    int nextUnit = 0;
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, GLuint(i), GLsizei(name.size()), &length, &size, &type, name.data());
+        GLint location = glGetUniformLocation(ID, name.data());
+        // Members of uniform blocks have no location.
+        if (location < 0)
+            continue;
+
+        Uniform uniform = { HashUniformName(name.data()), location, type, isSamplerType(type) ? nextUnit++ : -1 };
+        uniforms.push_back(uniform);
+        names.emplace_back(name.data(), length);
+
+        // Arrays are reported as "name[0]"; register the bare name too.
+        size_t bracket = names.back().find('[');
+        if (bracket != std::string::npos)
+        {
+            std::string bare = names.back().substr(0, bracket);
+            uniform.hash = HashUniformName(bare.c_str());
+            uniforms.push_back(uniform);
+            names.push_back(bare);
+        }
+    }
+
+    std::vector<size_t> order(uniforms.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return uniforms[a].hash < uniforms[b].hash; });
+
+    // Lookups only carry the hash, so two names sharing one would silently alias;
+    // treat it like a link error rather than hand out the wrong location.
+    std::vector<Uniform> sorted;
+    sorted.reserve(uniforms.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const Uniform& uniform = uniforms[order[i]];
+        if (!sorted.empty() && sorted.back().hash == uniform.hash)
+        {
+            if (sorted.back().location == uniform.location)
+                continue;
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: PROGRAM\nUniforms " << names[order[i - 1]] << " and "
+                << names[order[i]] << " have the same name hash; rename one of them" << std::endl;
+            uniforms.clear();
+            glDeleteProgram(ID);
+            ID = 0;
+            return;
+        }
+        sorted.push_back(uniform);
+    }
+    uniforms.swap(sorted);
+
+    // Samplers only need their unit once; draws then just bind textures to it.
+    GLint previous = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+    GLState::Get().UseProgram(ID);
+    for (const Uniform& uniform : uniforms)
+    {
+        if (uniform.unit >= 0)
+            glUniform1i(uniform.location, uniform.unit);
+    }
+    GLState::Get().UseProgram(GLuint(previous));
+
+    // Programs that use the per-frame block read it from its shared binding point.
+    GLuint frameBlock = glGetUniformBlockIndex(ID, "FrameData");
+    if (frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, frameBlock, FrameDataBinding);
 }
 
 
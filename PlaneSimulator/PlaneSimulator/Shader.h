@@ -1,12 +1,32 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <glm.hpp>
 
+// 32-bit FNV-1a of a uniform name; constexpr so literal names hash at compile time.
+constexpr uint32_t HashUniformName(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    while (*name)
+        hash = (hash ^ static_cast<unsigned char>(*name++)) * 16777619u;
+    return hash;
+}
+
+// A uniform name reduced to its hash. Hot paths keep these as static constexpr
+// constants; string literals convert implicitly, std::strings are hashed at the call.
+struct UniformName
+{
+    uint32_t hash;
+
+    constexpr UniformName(const char* name) : hash(HashUniformName(name)) {}
+    UniformName(const std::string& name) : hash(HashUniformName(name.c_str())) {}
+};
 
 class Shader
 {
@@ -19,30 +39,53 @@ public:
     // activate the shader
     // ------------------------------------------------------------------------
     void use();
-    // utility uniform functions
+    // utility uniform functions; names the program does not use are ignored
     // ------------------------------------------------------------------------
-    void setBool(const std::string& name, bool value) const;
+    void setBool(UniformName name, bool value) const;
     // ------------------------------------------------------------------------
-    void setInt(const std::string& name, int value) const;
+    // Setting a sampler also moves its entry in the sampler table.
+    void setInt(UniformName name, int value);
     // ------------------------------------------------------------------------
-    void setFloat(const std::string& name, float value) const;
+    void setFloat(UniformName name, float value) const;
     // ------------------------------------------------------------------------
-    void setMat4(const std::string& name, const glm::mat4& mat) const;
+    void setMat4(UniformName name, const glm::mat4& mat) const;
 
-    void SetVec3(const std::string& name, const glm::vec3& value) const;
-    void SetVec3(const std::string& name, float x, float y, float z) const;
+    void SetVec3(UniformName name, const glm::vec3& value) const;
+    void SetVec3(UniformName name, float x, float y, float z) const;
 
-    void setVec3(const std::string& name, const glm::vec3& value) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    void setVec3(UniformName name, const glm::vec3& value) const {
+        SetVec3(name, value);
     }
 
-    void setVec3(const std::string& name, float x, float y, float z) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &glm::vec3(x, y, z)[0]);
+    void setVec3(UniformName name, float x, float y, float z) const {
+        SetVec3(name, x, y, z);
     }
 
-    void SetVec4(const std::string& name, const glm::vec4& value) const;
-    void SetVec4(const std::string& name, float x, float y, float z, float w) const;
+    void SetVec4(UniformName name, const glm::vec4& value) const;
+    void SetVec4(UniformName name, float x, float y, float z, float w) const;
+
+    // Location of an active uniform, or -1.
+    GLint Location(UniformName name) const;
+    // Texture unit a sampler uniform reads from, or -1 if the program has no such sampler.
+    int SamplerUnit(UniformName name) const;
 private:
+    // One active uniform, found by binary search on hash.
+    struct Uniform
+    {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        // Texture unit for samplers, -1 otherwise.
+        int unit;
+    };
+    std::vector<Uniform> uniforms;
+
+    // Index into uniforms, or -1.
+    int findIndex(UniformName name) const;
+    // Fills the uniform table after linking, gives every sampler its own texture unit once
+    // and points a FrameData block at FrameDataBinding. Two active uniforms with the same
+    // name hash fail the program: it is deleted and ID left 0.
+    void reflectUniforms();
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type);
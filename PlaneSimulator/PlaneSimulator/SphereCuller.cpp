@@ -0,0 +1,76 @@
+#include "SphereCuller.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <emmintrin.h>
+
+namespace
+{
+    const uint8_t LaneCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+}
+
+size_t SphereCuller::Add(const glm::vec3& center, float radius)
+{
+    size_t padded = (count + 4) & ~size_t(3);
+    if (centerX.size() < padded)
+    {
+        centerX.resize(padded, 0.0f);
+        centerY.resize(padded, 0.0f);
+        centerZ.resize(padded, 0.0f);
+        radii.resize(padded, -FLT_MAX);
+        visible.resize(padded, 0);
+    }
+
+    centerX[count] = center.x;
+    centerY[count] = center.y;
+    centerZ[count] = center.z;
+    radii[count] = radius < 0.0f ? -FLT_MAX : radius;
+    return count++;
+}
+
+size_t SphereCuller::Cull(const Frustum& frustum)
+{
+    if (count == 0)
+        return 0;
+
+    // Lanes past count must not pass, whatever the arrays held before the last Clear.
+    size_t end = (count + 3) & ~size_t(3);
+    std::fill(radii.begin() + count, radii.begin() + end, -FLT_MAX);
+
+    __m128 planes[Frustum::PlaneCount][4];
+    for (int p = 0; p < Frustum::PlaneCount; p++)
+        for (int c = 0; c < 4; c++)
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+
+    const __m128 allSet = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < end; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&centerX[i]);
+        __m128 y = _mm_loadu_ps(&centerY[i]);
+        __m128 z = _mm_loadu_ps(&centerZ[i]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radii[i]));
+
+        // A sphere is out once its centre is further than its radius behind any plane.
+        __m128 inside = allSet;
+        for (int p = 0; p < Frustum::PlaneCount; p++)
+        {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+                _mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int lane = 0; lane < 4; lane++)
+            visible[i + lane] = uint8_t((mask >> lane) & 1);
+        visibleCount += LaneCount[mask];
+    }
+    return visibleCount;
+}
+
+void TransformSphere(const glm::mat4& transform, glm::vec3& center, float& radius)
+{
+    center = glm::vec3(transform * glm::vec4(center, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    radius *= scale;
+}
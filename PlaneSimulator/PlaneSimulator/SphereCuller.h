@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm.hpp>
+
+#include "Frustum.h"
+
+// World-space bounding spheres stored as separate x, y, z and radius arrays
+// and tested against the six frustum planes four at a time with SSE. Fill it
+// with Add every frame, run Cull once, then read IsVisible per sphere.
+class SphereCuller
+{
+public:
+    void Clear() { count = 0; }
+    // Returns the index IsVisible takes. A negative radius is never visible.
+    size_t Add(const glm::vec3& center, float radius);
+    size_t Count() const { return count; }
+
+    // Tests every sphere added since Clear; returns how many are at least partly inside.
+    size_t Cull(const Frustum& frustum);
+    bool IsVisible(size_t index) const { return visible[index] != 0; }
+
+private:
+    size_t count = 0;
+    // Padded to a multiple of four with spheres that are never visible.
+    std::vector<float> centerX, centerY, centerZ, radii;
+    std::vector<uint8_t> visible;
+};
+
+// Moves a model-space bounding sphere to world space; the radius grows with the largest axis scale.
+void TransformSphere(const glm::mat4& transform, glm::vec3& center, float& radius);
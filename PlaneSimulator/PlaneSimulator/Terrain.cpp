@@ -0,0 +1,342 @@
+#include "Terrain.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <iostream>
+
+#include "GLState.h"
+#include "RenderStats.h"
+
+namespace
+{
+    // Morph distances of the coarsest level, which has nothing to morph into.
+    const float NeverMorph = 1e30f;
+
+    bool boxIntersectsSphere(const glm::vec3& low, const glm::vec3& high, const glm::vec3& center, float radius)
+    {
+        glm::vec3 closest = glm::clamp(center, low, high);
+        glm::vec3 offset = closest - center;
+        return glm::dot(offset, offset) <= radius * radius;
+    }
+
+    GLuint createFloatTexture(GLint internalFormat, GLenum format, int width, int height, const float* data)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, data);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+}
+
+Terrain::~Terrain()
+{
+    Release();
+}
+
+bool Terrain::Create(const Heightfield& field, const TerrainSettings& terrainSettings)
+{
+    if (!field.IsValid())
+    {
+        std::cout << "ERROR::TERRAIN::Empty heightfield" << std::endl;
+        return false;
+    }
+
+    Release();
+    settings = terrainSettings;
+    // The grid must halve evenly into quadrants and morph targets.
+    int gridSize = 2;
+    while (gridSize < settings.gridSize)
+        gridSize *= 2;
+    settings.gridSize = gridSize;
+
+    origin = field.Origin();
+    extent = field.Extent();
+    spacing = field.Spacing();
+    buildLevels(field);
+    createGrid();
+
+    heightTexture = createFloatTexture(GL_R32F, GL_RED, field.Width(), field.Depth(), field.Heights().data());
+    if (!field.TexCoords().empty())
+        texCoordTexture = createFloatTexture(GL_RG32F, GL_RG, field.Width(), field.Depth(), &field.TexCoords()[0].x);
+    return true;
+}
+
+void Terrain::buildLevels(const Heightfield& field)
+{
+    int gridSize = settings.gridSize;
+    int cells = std::max(field.Width(), field.Depth()) - 1;
+    int rootCells = gridSize;
+    while (rootCells < cells)
+        rootCells *= 2;
+
+    levels.clear();
+    for (int nodeCells = gridSize; nodeCells <= rootCells; nodeCells *= 2)
+    {
+        Level level;
+        level.nodes = rootCells / nodeCells;
+        level.size = nodeCells * spacing;
+        // Nodes past the edge of the field stay empty: min above max.
+        level.heightRange.assign(size_t(level.nodes) * level.nodes, glm::vec2(FLT_MAX, -FLT_MAX));
+        levels.push_back(std::move(level));
+    }
+
+    // Finest level from the samples, including the ones on each node's far edge.
+    Level& finest = levels[0];
+    for (int z = 0; z < finest.nodes; z++)
+    {
+        for (int x = 0; x < finest.nodes; x++)
+        {
+            int firstX = x * gridSize, firstZ = z * gridSize;
+            if (firstX >= field.Width() || firstZ >= field.Depth())
+                continue;
+
+            glm::vec2& range = finest.heightRange[size_t(z) * finest.nodes + x];
+            int lastX = std::min(firstX + gridSize, field.Width() - 1);
+            int lastZ = std::min(firstZ + gridSize, field.Depth() - 1);
+            for (int sz = firstZ; sz <= lastZ; sz++)
+            {
+                for (int sx = firstX; sx <= lastX; sx++)
+                {
+                    float height = field.Height(sx, sz);
+                    range.x = std::min(range.x, height);
+                    range.y = std::max(range.y, height);
+                }
+            }
+        }
+    }
+
+    // Coarser levels from their four children.
+    for (size_t l = 1; l < levels.size(); l++)
+    {
+        const Level& children = levels[l - 1];
+        Level& level = levels[l];
+        for (int z = 0; z < level.nodes; z++)
+        {
+            for (int x = 0; x < level.nodes; x++)
+            {
+                glm::vec2& range = level.heightRange[size_t(z) * level.nodes + x];
+                for (int child = 0; child < 4; child++)
+                {
+                    const glm::vec2& childRange = children.heightRange[size_t(z * 2 + (child >> 1)) * children.nodes + x * 2 + (child & 1)];
+                    range.x = std::min(range.x, childRange.x);
+                    range.y = std::max(range.y, childRange.y);
+                }
+            }
+        }
+    }
+}
+
+void Terrain::createGrid()
+{
+    int gridSize = settings.gridSize;
+    int side = gridSize + 1;
+    std::vector<glm::vec2> vertices;
+    vertices.reserve(size_t(side) * side);
+    for (int z = 0; z <= gridSize; z++)
+        for (int x = 0; x <= gridSize; x++)
+            vertices.push_back(glm::vec2(x, z));
+
+    // Quadrants one after another (x then z, as the children are numbered), so a partly
+    // subdivided node can draw just the quarters no child covers.
+    std::vector<GLuint> indices;
+    int half = gridSize / 2;
+    for (int quadrant = 0; quadrant < 4; quadrant++)
+    {
+        int firstX = (quadrant & 1) * half, firstZ = (quadrant >> 1) * half;
+        for (int z = firstZ; z < firstZ + half; z++)
+        {
+            for (int x = firstX; x < firstX + half; x++)
+            {
+                GLuint corner = GLuint(z * side + x);
+                // Counter-clockwise seen from above.
+                indices.insert(indices.end(), { corner, corner + side, corner + 1 });
+                indices.insert(indices.end(), { corner + 1, corner + side, corner + side + 1 });
+            }
+        }
+    }
+    quadrantIndices = GLsizei(indices.size() / 4);
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &gridBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glGenBuffers(1, &instanceBuffer);
+
+    GLState& state = GLState::Get();
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, gridBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec2), vertices.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+    state.BindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+    // The chunk attributes are pointed at each batch's part of the buffer when it is drawn.
+    state.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+}
+
+void Terrain::computeRanges(const glm::mat4& projection, float viewportHeight)
+{
+    // A cell of size s at distance d covers s * projection[1][1] * viewportHeight / (2 d) pixels.
+    float range = spacing * projection[1][1] * viewportHeight / (2.0f * settings.cellPixels);
+    // Each band must be wide enough for its nodes to finish morphing before the next level
+    // takes over, or neighbouring chunks would not meet.
+    range = std::max(range, 4.0f * levels[0].size);
+
+    ranges.resize(levels.size());
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        ranges[l] = range;
+        range *= 2.0f;
+    }
+    // The root covers everything in view.
+    ranges.back() = FLT_MAX;
+}
+
+bool Terrain::select(int level, int x, int z)
+{
+    const Level& node = levels[level];
+    glm::vec2 heightRange = node.heightRange[size_t(z) * node.nodes + x];
+    // Past the edge of the field: nothing to draw, and nothing the parent has to cover.
+    if (heightRange.x > heightRange.y)
+        return true;
+
+    glm::vec2 fieldEnd = origin + extent;
+    glm::vec3 low(origin.x + x * node.size, heightRange.x, origin.y + z * node.size);
+    glm::vec3 high(std::min(low.x + node.size, fieldEnd.x), heightRange.y, std::min(low.z + node.size, fieldEnd.y));
+    if (!boxIntersectsSphere(low, high, cameraPosition, ranges[level]))
+        return false;
+
+    if (!frustum.IntersectsSphere((low + high) * 0.5f, glm::length(high - low) * 0.5f))
+    {
+        stats.culled++;
+        return true;
+    }
+
+    if (level == 0 || !boxIntersectsSphere(low, high, cameraPosition, ranges[level - 1]))
+    {
+        addChunk(level, x, z, -1);
+        return true;
+    }
+
+    // Children close enough draw themselves at a finer level; this node fills in the rest.
+    for (int child = 0; child < 4; child++)
+        if (!select(level - 1, x * 2 + (child & 1), z * 2 + (child >> 1)))
+            addChunk(level, x, z, child);
+    return true;
+}
+
+void Terrain::addChunk(int level, int x, int z, int quadrant)
+{
+    const Level& node = levels[level];
+    float previous = level > 0 ? ranges[level - 1] : 0.0f;
+    bool coarsest = level + 1 == int(levels.size());
+
+    Chunk chunk;
+    chunk.node = glm::vec4(origin.x + x * node.size, origin.y + z * node.size, node.size, float(level));
+    chunk.morph = coarsest ? glm::vec4(NeverMorph, 2.0f * NeverMorph, 0.0f, 0.0f)
+        : glm::vec4(previous + (ranges[level] - previous) * settings.morphStart, ranges[level], 0.0f, 0.0f);
+    selected[quadrant + 1].push_back(chunk);
+
+    stats.chunks++;
+    stats.triangles += size_t(quadrantIndices / 3) * (quadrant < 0 ? 4 : 1);
+}
+
+void Terrain::Draw(Shader& shader, unsigned int texture, const glm::mat4& view, const glm::mat4& projection, float viewportHeight)
+{
+    static constexpr UniformName HeightMap("heightMap");
+    static constexpr UniformName TexCoordMap("texCoordMap");
+    static constexpr UniformName HasTexCoordMap("hasTexCoordMap");
+    static constexpr UniformName Texture1("texture1");
+    static constexpr UniformName Field("field");
+    static constexpr UniformName Spacing("spacing");
+    static constexpr UniformName GridSize("gridSize");
+
+    if (!vao)
+        return;
+
+    stats = Stats();
+    for (std::vector<Chunk>& batch : selected)
+        batch.clear();
+    cameraPosition = glm::vec3(glm::inverse(view)[3]);
+    frustum = Frustum::FromMatrix(projection * view);
+    computeRanges(projection, viewportHeight);
+    select(int(levels.size()) - 1, 0, 0);
+    if (stats.chunks == 0)
+        return;
+
+    GLState& state = GLState::Get();
+    state.BindVertexArray(vao);
+    state.BindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (stats.chunks > instanceCapacity)
+        instanceCapacity = std::max(stats.chunks, instanceCapacity * 2);
+    // Orphaned every frame so the previous frame's draws never stall the upload.
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(Chunk), NULL, GL_STREAM_DRAW);
+    size_t offset = 0;
+    for (const std::vector<Chunk>& batch : selected)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, offset * sizeof(Chunk), batch.size() * sizeof(Chunk), batch.data());
+        offset += batch.size();
+    }
+
+    shader.use();
+    shader.SetVec4(Field, glm::vec4(origin, extent));
+    shader.setFloat(Spacing, spacing);
+    shader.setFloat(GridSize, float(settings.gridSize));
+    shader.setBool(HasTexCoordMap, texCoordTexture != 0);
+    state.BindTexture(std::max(shader.SamplerUnit(HeightMap), 0), GL_TEXTURE_2D, heightTexture);
+    if (texCoordTexture)
+        state.BindTexture(std::max(shader.SamplerUnit(TexCoordMap), 0), GL_TEXTURE_2D, texCoordTexture);
+    state.BindTexture(std::max(shader.SamplerUnit(Texture1), 0), GL_TEXTURE_2D, texture);
+
+    size_t fullDetailPerLeaf = size_t(quadrantIndices / 3) * 4;
+    offset = 0;
+    for (int batch = 0; batch < 5; batch++)
+    {
+        size_t count = selected[batch].size();
+        if (count == 0)
+            continue;
+
+        glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Chunk), (void*)(offset * sizeof(Chunk) + offsetof(Chunk, node)));
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Chunk), (void*)(offset * sizeof(Chunk) + offsetof(Chunk, morph)));
+        GLsizei indexCount = batch == 0 ? 4 * quadrantIndices : quadrantIndices;
+        size_t firstIndex = batch == 0 ? 0 : size_t(batch - 1) * quadrantIndices;
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(GLuint)), GLsizei(count));
+
+        // At full detail every chunk would be as many leaf chunks as its level's area holds.
+        size_t fullDetail = 0;
+        for (const Chunk& chunk : selected[batch])
+            fullDetail += (fullDetailPerLeaf << (2 * int(chunk.node.w))) / (batch == 0 ? 1 : 4);
+        RenderStats::Get().AddDraw(count * (indexCount / 3), fullDetail);
+        offset += count;
+    }
+}
+
+void Terrain::Release()
+{
+    GLState& state = GLState::Get();
+    if (vao)
+        state.DeleteVertexArrays(1, &vao);
+    GLuint buffers[] = { gridBuffer, indexBuffer, instanceBuffer };
+    for (GLuint& buffer : buffers)
+        if (buffer)
+            state.DeleteBuffers(1, &buffer);
+    if (heightTexture)
+        state.DeleteTextures(1, &heightTexture);
+    if (texCoordTexture)
+        state.DeleteTextures(1, &texCoordTexture);
+    vao = gridBuffer = indexBuffer = instanceBuffer = heightTexture = texCoordTexture = 0;
+    instanceCapacity = 0;
+    quadrantIndices = 0;
+    levels.clear();
+}
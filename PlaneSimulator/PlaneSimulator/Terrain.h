@@ -0,0 +1,105 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+#include <glm.hpp>
+
+#include "Frustum.h"
+#include "Heightfield.h"
+#include "Shader.h"
+
+struct TerrainSettings
+{
+    // Cells along each side of the grid mesh every chunk is drawn with; a power of two.
+    int gridSize = 32;
+    // Largest screen size, in pixels, of a full-detail cell before a finer level is needed.
+    float cellPixels = 6.0f;
+    // Fraction of each level's distance band after which it starts morphing into the next coarser one.
+    float morphStart = 0.7f;
+};
+
+// Heightfield terrain drawn as a quadtree of chunks (continuous distance-
+// dependent LOD, after Strugar's CDLOD). Every chunk is the same grid mesh,
+// scaled to its node and displaced in terrain_heightfield.vs by reading the
+// heightfield as a texture. A node's level follows its distance to the
+// camera, with the distance bands sized so a full-detail cell never covers
+// more than cellPixels pixels. Near the far end of its band each vertex
+// slides onto the next coarser grid, so levels meet without cracks or pops.
+// Chunks outside the frustum are skipped whole. The triangle count follows
+// the screen, not the size of the world. GL thread only.
+class Terrain
+{
+public:
+    struct Stats
+    {
+        size_t chunks = 0;
+        size_t culled = 0;
+        size_t triangles = 0;
+    };
+
+    Terrain() = default;
+    ~Terrain();
+
+    Terrain(const Terrain&) = delete;
+    Terrain& operator=(const Terrain&) = delete;
+
+    // Uploads the heights (and texture coordinates, if any) and builds the chunk tree.
+    bool Create(const Heightfield& field, const TerrainSettings& settings = TerrainSettings());
+    // Selects and draws the chunks seen by this camera, texture on the shader's texture1.
+    void Draw(Shader& shader, unsigned int texture, const glm::mat4& view, const glm::mat4& projection, float viewportHeight);
+
+    // What the last Draw selected.
+    const Stats& LastStats() const { return stats; }
+    // Deletes the GL objects early; the destructor does it otherwise.
+    void Release();
+
+private:
+    // One selected chunk as the vertex shader reads it: 32 bytes per instance.
+    struct Chunk
+    {
+        // World xz of the node's corner, its size and its level.
+        glm::vec4 node;
+        // Distances at which the chunk starts and finishes morphing.
+        glm::vec4 morph;
+    };
+
+    // Height bounds of every node, a level per entry, finest first.
+    struct Level
+    {
+        int nodes;
+        float size;
+        std::vector<glm::vec2> heightRange;
+    };
+
+    void createGrid();
+    void buildLevels(const Heightfield& field);
+    void computeRanges(const glm::mat4& projection, float viewportHeight);
+    // Returns false when the node lies beyond its level's range, so the parent draws that area itself.
+    bool select(int level, int x, int z);
+    void addChunk(int level, int x, int z, int quadrant);
+
+    TerrainSettings settings;
+    glm::vec2 origin = glm::vec2(0.0f);
+    glm::vec2 extent = glm::vec2(0.0f);
+    float spacing = 1.0f;
+    std::vector<Level> levels;
+    // Distance band of every level, refreshed by Draw.
+    std::vector<float> ranges;
+
+    // Per-frame selection: whole nodes first, then each quadrant.
+    std::vector<Chunk> selected[5];
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    Frustum frustum;
+    Stats stats;
+
+    GLuint vao = 0;
+    GLuint gridBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLuint instanceBuffer = 0;
+    GLuint heightTexture = 0;
+    GLuint texCoordTexture = 0;
+    size_t instanceCapacity = 0;
+    // Indices of one quadrant; the four are stored one after another.
+    GLsizei quadrantIndices = 0;
+};
@@ -0,0 +1,87 @@
+#include "TextureCache.h"
+
+#include <iostream>
+
+#include "GLState.h"
+#include "Paths.h"
+#include "TextureStreamer.h"
+
+TextureCache& TextureCache::Get()
+{
+    static TextureCache instance;
+    return instance;
+}
+
+std::string TextureCache::makeKey(const std::string& path, const TextureParams& params)
+{
+    std::string key = CanonicalPath(path);
+    key += '|';
+    key += params.gamma ? 'g' : 'l';
+    key += params.clampAlpha ? 'c' : 'r';
+    return key;
+}
+
+unsigned int TextureCache::Acquire(const std::string& path, const TextureParams& params, const ImageData* decoded)
+{
+    const std::string key = makeKey(path, params);
+
+    auto it = entries.find(key);
+    if (it != entries.end())
+    {
+        hits++;
+        it->second.references++;
+        return it->second.texture;
+    }
+
+    misses++;
+    unsigned int texture;
+    if (decoded)
+    {
+        texture = UploadTexture(*decoded, params);
+        if (texture == 0)
+        {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return 0;
+        }
+    }
+    else
+        texture = TextureStreamer::Get().Request(path, params);
+
+    entries[key] = { texture, 1 };
+    keysByTexture[texture] = key;
+    return texture;
+}
+
+void TextureCache::Release(unsigned int texture)
+{
+    auto key = keysByTexture.find(texture);
+    if (key == keysByTexture.end())
+        return;
+
+    auto it = entries.find(key->second);
+    if (--it->second.references > 0)
+        return;
+
+    TextureStreamer::Get().Cancel(texture);
+    GLState::Get().DeleteTextures(1, &texture);
+    entries.erase(it);
+    keysByTexture.erase(key);
+}
+
+TextureCache::Stats TextureCache::GetStats() const
+{
+    Stats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.live = entries.size();
+    return stats;
+}
+
+void TextureCache::PrintStats() const
+{
+    size_t lookups = hits + misses;
+    std::cout << "TEXTURE CACHE: " << entries.size() << " live, " << hits << " hits, " << misses << " misses";
+    if (lookups > 0)
+        std::cout << " (" << (100 * hits / lookups) << "% hit rate)";
+    std::cout << std::endl;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "TextureLoader.h"
+
+// Process-wide, reference-counted registry of 2D textures keyed by canonical
+// path plus load parameters, so every model referencing the same image file
+// shares one GL texture. GL thread only.
+class TextureCache
+{
+public:
+    struct Stats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t live = 0;
+    };
+
+    static TextureCache& Get();
+
+    // Returns the texture for path and params with one more reference. On a
+    // miss it is uploaded from decoded when given, otherwise streamed in.
+    // Returns 0 (and caches nothing) if decoded is given but invalid.
+    unsigned int Acquire(const std::string& path, const TextureParams& params = TextureParams(), const ImageData* decoded = nullptr);
+    // Drops one reference; the texture is deleted with the last one.
+    void Release(unsigned int texture);
+
+    Stats GetStats() const;
+    void PrintStats() const;
+
+private:
+    struct Entry
+    {
+        unsigned int texture;
+        unsigned int references;
+    };
+
+    TextureCache() = default;
+
+    static std::string makeKey(const std::string& path, const TextureParams& params);
+
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<unsigned int, std::string> keysByTexture;
+    size_t hits = 0;
+    size_t misses = 0;
+};
@@ -0,0 +1,457 @@
+#include "TextureCooker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <stb_image.h>
+
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+namespace
+{
+    // One RGBA8 mip level.
+    struct MipLevel
+    {
+        int width;
+        int height;
+        std::vector<unsigned char> pixels;
+    };
+
+    struct CookResult
+    {
+        std::string name;
+        int width;
+        int height;
+        bool alpha;
+        size_t uncompressedBytes;
+        size_t cookedBytes;
+    };
+
+    MipLevel downsample(const MipLevel& source)
+    {
+        MipLevel level;
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.pixels.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+        for (int y = 0; y < level.height; y++)
+        {
+            int y0 = std::min(2 * y, source.height - 1);
+            int y1 = std::min(2 * y + 1, source.height - 1);
+            for (int x = 0; x < level.width; x++)
+            {
+                int x0 = std::min(2 * x, source.width - 1);
+                int x1 = std::min(2 * x + 1, source.width - 1);
+
+                const unsigned char* a = &source.pixels[(static_cast<size_t>(y0) * source.width + x0) * 4];
+                const unsigned char* b = &source.pixels[(static_cast<size_t>(y0) * source.width + x1) * 4];
+                const unsigned char* c = &source.pixels[(static_cast<size_t>(y1) * source.width + x0) * 4];
+                const unsigned char* d = &source.pixels[(static_cast<size_t>(y1) * source.width + x1) * 4];
+                unsigned char* out = &level.pixels[(static_cast<size_t>(y) * level.width + x) * 4];
+                for (int channel = 0; channel < 4; channel++)
+                    out[channel] = static_cast<unsigned char>((a[channel] + b[channel] + c[channel] + d[channel] + 2) / 4);
+            }
+        }
+        return level;
+    }
+
+    uint16_t packRgb565(const float color[3])
+    {
+        int r = static_cast<int>(std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f));
+        int g = static_cast<int>(std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f));
+        int b = static_cast<int>(std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRgb565(uint16_t packed, int color[3])
+    {
+        int r = (packed >> 11) & 31;
+        int g = (packed >> 5) & 63;
+        int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Picks the nearest of the four palette entries for each texel; returns the squared error.
+    int fitColorIndices(const unsigned char* texels, uint16_t endpoint0, uint16_t endpoint1, uint32_t& indices)
+    {
+        int palette[4][3];
+        unpackRgb565(endpoint0, palette[0]);
+        unpackRgb565(endpoint1, palette[1]);
+        for (int channel = 0; channel < 3; channel++)
+        {
+            palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+            palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+        }
+
+        int totalError = 0;
+        indices = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            const unsigned char* texel = texels + i * 4;
+            int best = 0;
+            int bestError = INT32_MAX;
+            for (int p = 0; p < 4; p++)
+            {
+                int dr = texel[0] - palette[p][0];
+                int dg = texel[1] - palette[p][1];
+                int db = texel[2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+            totalError += bestError;
+        }
+        return totalError;
+    }
+
+    // Least squares endpoints for the current index assignment; false if the system is singular.
+    bool refineEndpoints(const unsigned char* texels, uint32_t indices, float endpoint0[3], float endpoint1[3])
+    {
+        static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = { 0.0f, 0.0f, 0.0f };
+        float bx[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+        {
+            float a = weights[(indices >> (2 * i)) & 3];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int channel = 0; channel < 3; channel++)
+            {
+                ax[channel] += a * texels[i * 4 + channel];
+                bx[channel] += b * texels[i * 4 + channel];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) < 1e-6f)
+            return false;
+
+        for (int channel = 0; channel < 3; channel++)
+        {
+            endpoint0[channel] = (ax[channel] * bb - bx[channel] * ab) / determinant;
+            endpoint1[channel] = (bx[channel] * aa - ax[channel] * ab) / determinant;
+        }
+        return true;
+    }
+
+    // BC1 colour block in four-colour mode: endpoints along the principal axis
+    // of the texel colours, inset slightly, then one least squares refinement.
+    void encodeColorBlock(const unsigned char* texels, unsigned char* out)
+    {
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+            for (int channel = 0; channel < 3; channel++)
+                mean[channel] += texels[i * 4 + channel] / 16.0f;
+
+        float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; i++)
+        {
+            float r = texels[i * 4 + 0] - mean[0];
+            float g = texels[i * 4 + 1] - mean[1];
+            float b = texels[i * 4 + 2] - mean[2];
+            covariance[0] += r * r;
+            covariance[1] += r * g;
+            covariance[2] += r * b;
+            covariance[3] += g * g;
+            covariance[4] += g * b;
+            covariance[5] += b * b;
+        }
+
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; iteration++)
+        {
+            float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            float length = std::sqrt(x * x + y * y + z * z);
+            if (length < 1e-6f)
+                break;
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+
+        float minProjection = 0.0f, maxProjection = 0.0f;
+        for (int i = 0; i < 16; i++)
+        {
+            float projection = (texels[i * 4 + 0] - mean[0]) * axis[0] + (texels[i * 4 + 1] - mean[1]) * axis[1] +
+                (texels[i * 4 + 2] - mean[2]) * axis[2];
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+        float inset = (maxProjection - minProjection) / 16.0f;
+        minProjection += inset;
+        maxProjection -= inset;
+
+        float endpoint0[3], endpoint1[3];
+        for (int channel = 0; channel < 3; channel++)
+        {
+            endpoint0[channel] = mean[channel] + axis[channel] * maxProjection;
+            endpoint1[channel] = mean[channel] + axis[channel] * minProjection;
+        }
+
+        uint16_t color0 = packRgb565(endpoint0);
+        uint16_t color1 = packRgb565(endpoint1);
+        uint32_t indices;
+        int error = fitColorIndices(texels, color0, color1, indices);
+
+        if (refineEndpoints(texels, indices, endpoint0, endpoint1))
+        {
+            uint16_t refined0 = packRgb565(endpoint0);
+            uint16_t refined1 = packRgb565(endpoint1);
+            uint32_t refinedIndices;
+            if (fitColorIndices(texels, refined0, refined1, refinedIndices) < error)
+            {
+                color0 = refined0;
+                color1 = refined1;
+                indices = refinedIndices;
+            }
+        }
+
+        // Four-colour mode needs color0 > color1; swapping the endpoints swaps
+        // index 0 with 1 and 2 with 3. Equal endpoints decode to a solid block.
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+            indices ^= 0x55555555;
+        }
+        else if (color0 == color1)
+            indices = 0;
+
+        out[0] = static_cast<unsigned char>(color0 & 0xFF);
+        out[1] = static_cast<unsigned char>(color0 >> 8);
+        out[2] = static_cast<unsigned char>(color1 & 0xFF);
+        out[3] = static_cast<unsigned char>(color1 >> 8);
+        for (int i = 0; i < 4; i++)
+            out[4 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    // BC3 alpha block in eight-value mode between the block's alpha extremes.
+    void encodeAlphaBlock(const unsigned char* texels, unsigned char* out)
+    {
+        int alpha0 = 0, alpha1 = 255;
+        for (int i = 0; i < 16; i++)
+        {
+            alpha0 = std::max(alpha0, static_cast<int>(texels[i * 4 + 3]));
+            alpha1 = std::min(alpha1, static_cast<int>(texels[i * 4 + 3]));
+        }
+
+        uint64_t indices = 0;
+        if (alpha0 != alpha1)
+        {
+            int palette[8];
+            palette[0] = alpha0;
+            palette[1] = alpha1;
+            for (int code = 2; code < 8; code++)
+                palette[code] = ((8 - code) * alpha0 + (code - 1) * alpha1) / 7;
+
+            for (int i = 0; i < 16; i++)
+            {
+                int alpha = texels[i * 4 + 3];
+                int best = 0;
+                for (int code = 1; code < 8; code++)
+                {
+                    if (std::abs(alpha - palette[code]) < std::abs(alpha - palette[best]))
+                        best = code;
+                }
+                indices |= static_cast<uint64_t>(best) << (3 * i);
+            }
+        }
+
+        out[0] = static_cast<unsigned char>(alpha0);
+        out[1] = static_cast<unsigned char>(alpha1);
+        for (int i = 0; i < 6; i++)
+            out[2 + i] = static_cast<unsigned char>(indices >> (8 * i));
+    }
+
+    void compressLevel(const MipLevel& level, bool alpha, std::vector<unsigned char>& out)
+    {
+        const int blocksX = (level.width + 3) / 4;
+        const int blocksY = (level.height + 3) / 4;
+        out.resize(static_cast<size_t>(blocksX) * blocksY * (alpha ? 16 : 8));
+
+        unsigned char texels[16 * 4];
+        unsigned char* block = out.data();
+        for (int by = 0; by < blocksY; by++)
+        {
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                // Edge blocks of levels that are not a multiple of 4 repeat the last row/column.
+                for (int y = 0; y < 4; y++)
+                {
+                    int sy = std::min(by * 4 + y, level.height - 1);
+                    for (int x = 0; x < 4; x++)
+                    {
+                        int sx = std::min(bx * 4 + x, level.width - 1);
+                        std::memcpy(texels + (y * 4 + x) * 4, &level.pixels[(static_cast<size_t>(sy) * level.width + sx) * 4], 4);
+                    }
+                }
+
+                if (alpha)
+                {
+                    encodeAlphaBlock(texels, block);
+                    block += 8;
+                }
+                encodeColorBlock(texels, block);
+                block += 8;
+            }
+        }
+    }
+
+    bool cookTexture(const std::string& sourcePath, CookResult& result)
+    {
+        MipLevel level;
+        int channels;
+        unsigned char* pixels = stbi_load(sourcePath.c_str(), &level.width, &level.height, &channels, 4);
+        if (!pixels)
+        {
+            std::cout << "ERROR::TEXTURECOOKER::Could not decode " << sourcePath << std::endl;
+            return false;
+        }
+        level.pixels.assign(pixels, pixels + static_cast<size_t>(level.width) * level.height * 4);
+        stbi_image_free(pixels);
+
+        bool alpha = false;
+        for (size_t i = 3; i < level.pixels.size() && !alpha; i += 4)
+            alpha = level.pixels[i] != 255;
+
+        result.name = std::filesystem::path(sourcePath).filename().string();
+        result.width = level.width;
+        result.height = level.height;
+        result.alpha = alpha;
+        result.uncompressedBytes = 0;
+
+        std::vector<std::vector<unsigned char>> levels;
+        for (;;)
+        {
+            result.uncompressedBytes += level.pixels.size();
+            levels.emplace_back();
+            compressLevel(level, alpha, levels.back());
+            if (level.width == 1 && level.height == 1)
+                break;
+            level = downsample(level);
+        }
+
+        KtxHeader header = {};
+        std::memcpy(header.identifier, KtxIdentifier, sizeof(KtxIdentifier));
+        header.endianness = KtxEndianness;
+        header.glTypeSize = 1;
+        header.glInternalFormat = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        header.glBaseInternalFormat = alpha ? GL_RGBA : GL_RGB;
+        header.pixelWidth = result.width;
+        header.pixelHeight = result.height;
+        header.numberOfFaces = 1;
+        header.numberOfMipmapLevels = static_cast<uint32_t>(levels.size());
+
+        const std::string cookedPath = CookedTexturePath(sourcePath);
+        std::ofstream out(cookedPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open())
+        {
+            std::cout << "ERROR::TEXTURECOOKER::Could not write " << cookedPath << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        result.cookedBytes = sizeof(header);
+        for (const std::vector<unsigned char>& blocks : levels)
+        {
+            // Block data is always a multiple of 8 bytes, so no mip padding is needed.
+            uint32_t imageSize = static_cast<uint32_t>(blocks.size());
+            out.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+            out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+            result.cookedBytes += sizeof(imageSize) + blocks.size();
+        }
+
+        if (!out)
+        {
+            out.close();
+            std::remove(cookedPath.c_str());
+            std::cout << "ERROR::TEXTURECOOKER::Failed writing " << cookedPath << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool isCookableImage(const std::filesystem::path& path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension == ".jpg" || extension == ".jpeg" || extension == ".png";
+    }
+}
+
+bool CookTexture(const std::string& sourcePath)
+{
+    CookResult result;
+    return cookTexture(sourcePath, result);
+}
+
+size_t CookTextures(const std::string& directory)
+{
+    std::vector<std::string> sources;
+    std::error_code error;
+    for (std::filesystem::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file() && isCookableImage(it->path()) && !IsCookedTextureCurrent(it->path().string()))
+            sources.push_back(it->path().string());
+    }
+
+    std::mutex resultsMutex;
+    std::vector<CookResult> results;
+    ThreadPool& pool = ThreadPool::Shared();
+    for (const std::string& source : sources)
+    {
+        pool.Submit([&resultsMutex, &results, source]()
+        {
+            CookResult result;
+            if (!cookTexture(source, result))
+                return;
+            std::lock_guard<std::mutex> lock(resultsMutex);
+            results.push_back(result);
+        });
+    }
+    pool.Wait();
+
+    std::sort(results.begin(), results.end(), [](const CookResult& a, const CookResult& b) { return a.name < b.name; });
+
+    size_t uncompressedTotal = 0, cookedTotal = 0;
+    std::cout << std::left << std::setw(48) << "texture" << std::right << std::setw(12) << "size" << std::setw(8) << "format"
+        << std::setw(12) << "RGBA KB" << std::setw(12) << "cooked KB" << std::setw(8) << "ratio" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (const CookResult& result : results)
+    {
+        std::cout << std::left << std::setw(48) << result.name << std::right
+            << std::setw(12) << (std::to_string(result.width) + "x" + std::to_string(result.height))
+            << std::setw(8) << (result.alpha ? "BC3" : "BC1")
+            << std::setw(12) << result.uncompressedBytes / 1024.0
+            << std::setw(12) << result.cookedBytes / 1024.0
+            << std::setw(7) << double(result.uncompressedBytes) / result.cookedBytes << "x" << std::endl;
+        uncompressedTotal += result.uncompressedBytes;
+        cookedTotal += result.cookedBytes;
+    }
+    std::cout << "Cooked " << results.size() << " of " << sources.size() << " stale textures, "
+        << uncompressedTotal / (1024.0 * 1024.0) << " MB of RGBA mips -> " << cookedTotal / (1024.0 * 1024.0) << " MB" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+
+    return results.size();
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// Offline texture cooking. Each JPG/PNG source is decoded, its mip chain is
+// box filtered down to 1x1 on the CPU and every level is block compressed:
+// BC1 for opaque images, BC3 when any texel has alpha. The result is written
+// as a KTX file next to the source (see CookedTexturePath) and the runtime
+// loaders upload those blocks as they are, without glGenerateMipmap.
+
+// Cooks one image; false if it cannot be decoded or written.
+bool CookTexture(const std::string& sourcePath);
+
+// Cooks every image under directory whose cooked file is missing or stale,
+// on the shared worker pool, and prints the size of each result. Returns the
+// number of files written.
+size_t CookTextures(const std::string& directory);
@@ -0,0 +1,207 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <stb_image.h>
+
+#include "GLState.h"
+#include "MappedFile.h"
+
+const unsigned char KtxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+namespace
+{
+    size_t compressedLevelSize(GLenum internalFormat, int width, int height)
+    {
+        size_t blockBytes = internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+    }
+
+    GLenum compressedInternalFormat(GLenum internalFormat, bool gamma)
+    {
+        if (!gamma)
+            return internalFormat;
+        return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    }
+}
+
+ImageData::~ImageData()
+{
+    if (pixels)
+        stbi_image_free(pixels);
+}
+
+ImageData::ImageData(ImageData&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+ImageData& ImageData::operator=(ImageData&& other) noexcept
+{
+    if (this != &other)
+    {
+        std::swap(width, other.width);
+        std::swap(height, other.height);
+        std::swap(channels, other.channels);
+        std::swap(pixels, other.pixels);
+    }
+    return *this;
+}
+
+bool ImageData::Load(const std::string& path)
+{
+    if (pixels)
+        stbi_image_free(pixels);
+
+    pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    return pixels != nullptr;
+}
+
+GLenum ImageFormat(int channels)
+{
+    if (channels == 1)
+        return GL_RED;
+    if (channels == 2)
+        return GL_RG;
+    if (channels == 4)
+        return GL_RGBA;
+    return GL_RGB;
+}
+
+unsigned int UploadTexture(const ImageData& image, const TextureParams& params)
+{
+    if (!image.IsValid())
+        return 0;
+
+    GLenum format = ImageFormat(image.channels);
+    GLint internalFormat = format;
+    if (params.gamma && format == GL_RGB)
+        internalFormat = GL_SRGB8;
+    else if (params.gamma && format == GL_RGBA)
+        internalFormat = GL_SRGB8_ALPHA8;
+
+    GLint wrap = params.clampAlpha && format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
+
+
+bool CompressedImage::Load(const std::string& path)
+{
+    levels.clear();
+    blocks.clear();
+
+    MappedFile file(path);
+    if (!file.IsOpen() || file.Size() < sizeof(KtxHeader))
+        return false;
+
+    KtxHeader header;
+    std::memcpy(&header, file.Data(), sizeof(header));
+    if (std::memcmp(header.identifier, KtxIdentifier, sizeof(KtxIdentifier)) != 0 || header.endianness != KtxEndianness ||
+        header.glType != 0 || header.numberOfFaces != 1 || header.numberOfArrayElements != 0 || header.numberOfMipmapLevels == 0 ||
+        (header.glInternalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header.glInternalFormat != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT))
+        return false;
+
+    internalFormat = header.glInternalFormat;
+    width = static_cast<int>(header.pixelWidth);
+    height = static_cast<int>(header.pixelHeight);
+
+    size_t cursor = sizeof(header) + header.bytesOfKeyValueData;
+    int levelWidth = width;
+    int levelHeight = height;
+    for (uint32_t i = 0; i < header.numberOfMipmapLevels; i++)
+    {
+        uint32_t imageSize;
+        if (cursor + sizeof(imageSize) > file.Size())
+            break;
+        std::memcpy(&imageSize, file.Data() + cursor, sizeof(imageSize));
+        cursor += sizeof(imageSize);
+
+        if (imageSize != compressedLevelSize(internalFormat, levelWidth, levelHeight) || cursor + imageSize > file.Size())
+            break;
+
+        Level level = { levelWidth, levelHeight, blocks.size(), imageSize };
+        levels.push_back(level);
+        blocks.insert(blocks.end(), file.Data() + cursor, file.Data() + cursor + imageSize);
+        cursor += (imageSize + 3) & ~3u;
+
+        levelWidth = std::max(1, levelWidth / 2);
+        levelHeight = std::max(1, levelHeight / 2);
+    }
+
+    if (levels.size() != header.numberOfMipmapLevels)
+    {
+        levels.clear();
+        blocks.clear();
+        return false;
+    }
+    return true;
+}
+
+std::string CookedTexturePath(const std::string& sourcePath)
+{
+    return sourcePath + ".ktx";
+}
+
+bool IsCookedTextureCurrent(const std::string& sourcePath)
+{
+    std::error_code error;
+    std::filesystem::file_time_type cooked = std::filesystem::last_write_time(CookedTexturePath(sourcePath), error);
+    if (error)
+        return false;
+    std::filesystem::file_time_type source = std::filesystem::last_write_time(sourcePath, error);
+    return error || cooked >= source;
+}
+
+bool CompressedTexturesSupported()
+{
+    return GLEW_EXT_texture_compression_s3tc != 0;
+}
+
+void SpecifyCompressedLevels(GLenum target, const CompressedImage& image, bool gamma, bool fromUnpackBuffer)
+{
+    GLenum internalFormat = compressedInternalFormat(image.internalFormat, gamma);
+    for (size_t i = 0; i < image.levels.size(); i++)
+    {
+        const CompressedImage::Level& level = image.levels[i];
+        const void* data = fromUnpackBuffer ? reinterpret_cast<const void*>(level.offset) : image.blocks.data() + level.offset;
+        glCompressedTexImage2D(target, static_cast<GLint>(i), internalFormat, level.width, level.height, 0,
+            static_cast<GLsizei>(level.size), data);
+    }
+}
+
+unsigned int UploadCompressedTexture(const CompressedImage& image, const TextureParams& params)
+{
+    if (!image.IsValid())
+        return 0;
+
+    GLint wrap = params.clampAlpha && image.HasAlpha() ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, textureID);
+    SpecifyCompressedLevels(GL_TEXTURE_2D, image, params.gamma);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size()) - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct TextureParams
+{
+    // Sample through an sRGB internal format.
+    bool gamma = false;
+    // Clamp to edge instead of repeating when the image has an alpha channel.
+    bool clampAlpha = false;
+};
+
+// Pixels decoded by stb_image. Move-only; the pixels are freed with the object.
+struct ImageData
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char* pixels = nullptr;
+
+    ImageData() = default;
+    ~ImageData();
+    ImageData(const ImageData&) = delete;
+    ImageData& operator=(const ImageData&) = delete;
+    ImageData(ImageData&& other) noexcept;
+    ImageData& operator=(ImageData&& other) noexcept;
+
+    // Decodes the file at path; safe to call from worker threads.
+    bool Load(const std::string& path);
+    bool IsValid() const { return pixels != nullptr; }
+    size_t ByteSize() const { return static_cast<size_t>(width) * height * channels; }
+};
+
+GLenum ImageFormat(int channels);
+
+// Creates a 2D texture from decoded pixels and builds its mip chain; 0 if the image is invalid.
+unsigned int UploadTexture(const ImageData& image, const TextureParams& params = TextureParams());
+
+// KTX 1.1 file header; the cooker writes one face, no array elements and no key/value data.
+struct KtxHeader
+{
+    unsigned char identifier[12];
+    uint32_t endianness;
+    uint32_t glType;
+    uint32_t glTypeSize;
+    uint32_t glFormat;
+    uint32_t glInternalFormat;
+    uint32_t glBaseInternalFormat;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t numberOfArrayElements;
+    uint32_t numberOfFaces;
+    uint32_t numberOfMipmapLevels;
+    uint32_t bytesOfKeyValueData;
+};
+
+extern const unsigned char KtxIdentifier[12];
+const uint32_t KtxEndianness = 0x04030201;
+
+// BC1/BC3 blocks of a cooked texture with its complete mip chain, levels stored back to back.
+struct CompressedImage
+{
+    struct Level
+    {
+        int width;
+        int height;
+        size_t offset;
+        size_t size;
+    };
+
+    GLenum internalFormat = 0;
+    int width = 0;
+    int height = 0;
+    std::vector<Level> levels;
+    std::vector<unsigned char> blocks;
+
+    // Reads a KTX file written by the texture cooker; safe to call from worker threads.
+    bool Load(const std::string& path);
+    bool IsValid() const { return !levels.empty(); }
+    bool HasAlpha() const { return internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; }
+    size_t ByteSize() const { return blocks.size(); }
+};
+
+// Where the cooker puts the compressed version of sourcePath.
+std::string CookedTexturePath(const std::string& sourcePath);
+// True when the cooked file exists and is not older than its source.
+bool IsCookedTextureCurrent(const std::string& sourcePath);
+// Whether the driver takes S3TC blocks; cooked files are ignored otherwise. Valid after glewInit.
+bool CompressedTexturesSupported();
+
+// Specifies every level of image on target (GL_TEXTURE_2D or a cube map face), reading the
+// blocks from image or, with fromUnpackBuffer, at the same offsets in the bound unpack buffer.
+void SpecifyCompressedLevels(GLenum target, const CompressedImage& image, bool gamma, bool fromUnpackBuffer = false);
+
+// Creates a 2D texture from cooked blocks; the mip chain comes from the file. 0 if the image is invalid.
+unsigned int UploadCompressedTexture(const CompressedImage& image, const TextureParams& params = TextureParams());
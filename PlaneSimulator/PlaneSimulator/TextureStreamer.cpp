@@ -0,0 +1,194 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "GLState.h"
+
+namespace
+{
+    const unsigned char PlaceholderPixel[4] = { 128, 128, 128, 255 };
+
+    void setSamplerParameters(const TextureParams& params, bool alpha)
+    {
+        GLint wrap = params.clampAlpha && alpha ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+}
+
+TextureStreamer& TextureStreamer::Get()
+{
+    static TextureStreamer instance;
+    return instance;
+}
+
+unsigned int TextureStreamer::Request(const std::string& path, const TextureParams& params)
+{
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    GLState::Get().BindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PlaceholderPixel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    const unsigned long long request = nextRequest++;
+    pending[texture] = request;
+
+    const bool preferCooked = CompressedTexturesSupported();
+    ThreadPool::Shared().Submit([this, texture, request, path, params, preferCooked]()
+    {
+        std::unique_ptr<Job> job(new Job());
+        job->texture = texture;
+        job->request = request;
+        job->params = params;
+        job->path = path;
+        bool cooked = preferCooked && IsCookedTextureCurrent(path) && job->compressed.Load(CookedTexturePath(path));
+        if (!cooked && !job->image.Load(path))
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decoded.push_back(std::move(job));
+    });
+
+    return texture;
+}
+
+void TextureStreamer::Cancel(unsigned int texture)
+{
+    pending.erase(texture);
+    if (active && active->texture == texture)
+        active->texture = 0;
+}
+
+void TextureStreamer::Update()
+{
+    if (unpackBuffers[0] == 0)
+        glGenBuffers(2, unpackBuffers);
+
+    size_t budget = frameBudget;
+    while (budget > 0)
+    {
+        if (!active)
+        {
+            startJob();
+            if (!active)
+                break;
+        }
+
+        if (mapped)
+        {
+            size_t chunk = std::min(budget, active->ByteSize() - copied);
+            std::memcpy(mapped + copied, active->Bytes() + copied, chunk);
+            copied += chunk;
+            budget -= chunk;
+        }
+
+        if (!mapped || copied == active->ByteSize())
+            finishJob();
+    }
+}
+
+void TextureStreamer::startJob()
+{
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        while (!decoded.empty() && !active)
+        {
+            std::unique_ptr<Job> job = std::move(decoded.front());
+            decoded.pop_front();
+            auto owner = pending.find(job->texture);
+            if (owner != pending.end() && owner->second == job->request)
+                active = std::move(job);
+        }
+    }
+    if (!active)
+        return;
+
+    copied = 0;
+    mapped = nullptr;
+    if (active->ByteSize() == 0)
+        return;
+
+    // Respecifying the store orphans whatever transfer the driver still runs
+    // from this buffer, so filling it never waits on the GPU.
+    GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffers[nextBuffer]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, active->ByteSize(), NULL, GL_STREAM_DRAW);
+    mapped = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, active->ByteSize(),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::finishJob()
+{
+    std::unique_ptr<Job> job = std::move(active);
+    unsigned int buffer = unpackBuffers[nextBuffer];
+
+    if (mapped)
+    {
+        GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        mapped = nullptr;
+        nextBuffer ^= 1;
+
+        if (job->texture != 0 && intact && job->compressed.IsValid())
+        {
+            const CompressedImage& image = job->compressed;
+            GLState::Get().BindTexture(GL_TEXTURE_2D, job->texture);
+            SpecifyCompressedLevels(GL_TEXTURE_2D, image, job->params.gamma, true);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.levels.size()) - 1);
+            setSamplerParameters(job->params, image.HasAlpha());
+        }
+        else if (job->texture != 0 && intact)
+        {
+            const ImageData& image = job->image;
+            GLenum format = ImageFormat(image.channels);
+            GLint internalFormat = format;
+            if (job->params.gamma && format == GL_RGB)
+                internalFormat = GL_SRGB8;
+            else if (job->params.gamma && format == GL_RGBA)
+                internalFormat = GL_SRGB8_ALPHA8;
+
+            GLState::Get().BindTexture(GL_TEXTURE_2D, job->texture);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glGenerateMipmap(GL_TEXTURE_2D);
+            setSamplerParameters(job->params, format == GL_RGBA);
+        }
+        GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // A cancelled job has texture 0 and must not drop a newer request that reuses its name.
+    if (job->texture != 0)
+        pending.erase(job->texture);
+}
+
+void TextureStreamer::Shutdown()
+{
+    if (mapped)
+    {
+        GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffers[nextBuffer]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        GLState::Get().BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        mapped = nullptr;
+    }
+    active.reset();
+    pending.clear();
+
+    // Decode tasks still running push into the queue; let them finish first.
+    ThreadPool::Shared().Wait();
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        decoded.clear();
+    }
+
+    if (unpackBuffers[0] != 0)
+        GLState::Get().DeleteBuffers(2, unpackBuffers);
+    unpackBuffers[0] = unpackBuffers[1] = 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+
+// Streams textures in without stalling the frame. Request() returns a texture
+// name at once that samples a 1x1 placeholder; the file is decoded on the
+// worker pool and its pixels are copied into a double-buffered ring of pixel
+// unpack buffers, at most FrameBudget bytes per Update(). Once a buffer holds
+// the whole image the texture is respecified from it, so the copy to the GPU
+// runs asynchronously and the texture never shows a half-uploaded image.
+// A current cooked file (see TextureCooker.h) is streamed instead of the
+// source when the driver supports S3TC; its blocks carry their own mip chain.
+class TextureStreamer
+{
+public:
+    static const size_t DefaultFrameBudget = 4 * 1024 * 1024;
+
+    static TextureStreamer& Get();
+
+    // GL thread only.
+    unsigned int Request(const std::string& path, const TextureParams& params = TextureParams());
+    // Advances the pending uploads; call once per frame on the GL thread.
+    void Update();
+    // Drops any pending upload into texture, e.g. before the texture is deleted.
+    void Cancel(unsigned int texture);
+    // Deletes the unpack buffers; pending requests are discarded.
+    void Shutdown();
+
+    void SetFrameBudget(size_t bytes) { frameBudget = bytes; }
+    // Requests that have not finished uploading yet.
+    size_t PendingCount() const { return pending.size(); }
+
+private:
+    struct Job
+    {
+        unsigned int texture;
+        // GL reuses deleted texture names, so a job only belongs to its texture while this matches pending.
+        unsigned long long request;
+        TextureParams params;
+        std::string path;
+        // Exactly one of these holds data, or neither if loading failed.
+        ImageData image;
+        CompressedImage compressed;
+
+        const unsigned char* Bytes() const { return compressed.IsValid() ? compressed.blocks.data() : image.pixels; }
+        size_t ByteSize() const { return compressed.IsValid() ? compressed.ByteSize() : image.ByteSize(); }
+    };
+
+    TextureStreamer() = default;
+
+    void startJob();
+    void finishJob();
+
+    size_t frameBudget = DefaultFrameBudget;
+
+    // Filled by decode tasks, drained by Update().
+    std::mutex decodedMutex;
+    std::deque<std::unique_ptr<Job>> decoded;
+
+    // Texture name -> id of the request that still owns it.
+    std::unordered_map<unsigned int, unsigned long long> pending;
+    unsigned long long nextRequest = 1;
+
+    // Upload in progress: which ring buffer it fills and how much is copied.
+    std::unique_ptr<Job> active;
+    unsigned char* mapped = nullptr;
+    size_t copied = 0;
+
+    unsigned int unpackBuffers[2] = { 0, 0 };
+    unsigned int nextBuffer = 0;
+};
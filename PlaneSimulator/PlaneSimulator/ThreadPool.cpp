@@ -0,0 +1,120 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+{
+    if (threadCount == 0)
+    {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        threadCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return tasks.empty() && busy == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if (count == 0)
+        return;
+
+    // Helpers may only start after the caller has finished every index and
+    // returned, so they hold the state by shared_ptr and never touch body then.
+    struct State
+    {
+        std::function<void(size_t)> body;
+        size_t count;
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> finished{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    std::shared_ptr<State> state = std::make_shared<State>();
+    state->body = body;
+    state->count = count;
+
+    auto drain = [](State& s)
+    {
+        size_t i;
+        while ((i = s.next.fetch_add(1)) < s.count)
+        {
+            s.body(i);
+            if (s.finished.fetch_add(1) + 1 == s.count)
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.done.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(count - 1, workers.size());
+    for (size_t i = 0; i < helpers; i++)
+        Submit([state, drain]() { drain(*state); });
+
+    drain(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state] { return state->finished.load() == state->count; });
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty())
+                return;
+
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            busy++;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy--;
+            if (tasks.empty() && busy == 0)
+                idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads draining a FIFO of tasks.
+class ThreadPool
+{
+public:
+    // threadCount 0 uses one worker per hardware thread, minus the caller's.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Pool shared by the loaders and simulation systems.
+    static ThreadPool& Shared();
+
+    void Submit(std::function<void()> task);
+    // Blocks until the queue is empty and every worker is idle.
+    void Wait();
+    // Calls body(i) for every i in [0, count) on the workers and the calling
+    // thread, returning once all calls have finished. Unlike Wait() it only
+    // waits for its own work, so it is safe to call from inside a task.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    unsigned int ThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable idle;
+    unsigned int busy = 0;
+    bool stopping = false;
+};
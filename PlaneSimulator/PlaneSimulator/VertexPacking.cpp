@@ -0,0 +1,105 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    int16_t toSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f));
+    }
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    int exponent = static_cast<int>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (exponent >= 31)
+        return sign | 0x7C00;
+    if (exponent <= 0)
+    {
+        // Denormal or zero: shift the implicit bit in and round to nearest.
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            half++;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint16_t half = static_cast<uint16_t>(sign | (exponent << 10) | (mantissa >> 13));
+    // Round to nearest; a carry out of the mantissa correctly bumps the exponent.
+    if (mantissa & 0x1000)
+        half++;
+    return half;
+}
+
+void OctEncode(const glm::vec3& normal, int16_t out[2])
+{
+    float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (length == 0.0f)
+    {
+        out[0] = out[1] = 0;
+        return;
+    }
+
+    float x = normal.x / length;
+    float y = normal.y / length;
+    if (normal.z < 0.0f)
+    {
+        // Fold the lower hemisphere over the diagonals of the square.
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    out[0] = toSnorm16(x);
+    out[1] = toSnorm16(y);
+}
+
+bool PackVertices(const Vertex* vertices, size_t count, std::vector<PackedVertex>& packed, PackedVertexBounds& bounds)
+{
+    if (count == 0)
+        return false;
+
+    glm::vec3 minimum = vertices[0].Position;
+    glm::vec3 maximum = vertices[0].Position;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (std::fabs(vertices[i].TexCoords.x) > MaxPackedTexCoord || std::fabs(vertices[i].TexCoords.y) > MaxPackedTexCoord)
+            return false;
+        minimum = glm::min(minimum, vertices[i].Position);
+        maximum = glm::max(maximum, vertices[i].Position);
+    }
+
+    bounds.positionOffset = (minimum + maximum) * 0.5f;
+    bounds.positionScale = glm::max((maximum - minimum) * 0.5f, glm::vec3(1e-6f));
+
+    packed.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+
+        glm::vec3 position = (vertex.Position - bounds.positionOffset) / bounds.positionScale;
+        out.position[0] = toSnorm16(position.x);
+        out.position[1] = toSnorm16(position.y);
+        out.position[2] = toSnorm16(position.z);
+        out.position[3] = 0;
+
+        OctEncode(vertex.Normal, out.normal);
+
+        out.texCoords[0] = FloatToHalf(vertex.TexCoords.x);
+        out.texCoords[1] = FloatToHalf(vertex.TexCoords.y);
+    }
+    return true;
+}
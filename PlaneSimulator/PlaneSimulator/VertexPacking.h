@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Mesh.h"
+
+// Compact 16-byte vertex. The position is snorm16 relative to the mesh
+// bounds (decoded as position * positionScale + positionOffset), the normal
+// is octahedral-encoded snorm16 and the UVs are half floats.
+struct PackedVertex
+{
+    int16_t position[4];
+    int16_t normal[2];
+    uint16_t texCoords[2];
+};
+
+// Decode parameters of one packed mesh, set on the shader before it is drawn.
+struct PackedVertexBounds
+{
+    glm::vec3 positionScale = glm::vec3(1.0f);
+    glm::vec3 positionOffset = glm::vec3(0.0f);
+};
+
+// Half floats lose sub-texel precision on large repeating UVs; meshes with
+// coordinates beyond this keep the full float layout.
+const float MaxPackedTexCoord = 8.0f;
+
+uint16_t FloatToHalf(float value);
+// Unit vector to two snorm16 octahedral coordinates.
+void OctEncode(const glm::vec3& normal, int16_t out[2]);
+
+// Packs vertices; false (and nothing written) if the mesh's UVs do not fit a half float well.
+bool PackVertices(const Vertex* vertices, size_t count, std::vector<PackedVertex>& packed, PackedVertexBounds& bounds);
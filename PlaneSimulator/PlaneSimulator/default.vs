@@ -9,12 +9,26 @@ layout(location = 6) in vec3 aSpecular;
 
 out vec2 TexCoords;
 
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 skyColor;
+    vec4 timeOfDay;
+} frame;
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Packed meshes store positions as snorm16 relative to their bounds
+uniform vec3 posScale = vec3(1.0);
+uniform vec3 posOffset = vec3(0.0);
 
 void main()
 {
 	TexCoords = aTexCoord;
-	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	gl_Position = frame.viewProjection * model * vec4(aPos * posScale + posOffset, 1.0);
 }
\ No newline at end of file
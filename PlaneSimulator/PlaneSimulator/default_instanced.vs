@@ -0,0 +1,38 @@
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aColor;
+layout(location = 2) in vec2 aTexCoord;
+layout(location = 3) in vec3 aNormal;
+layout(location = 4) in vec3 aAmbient;
+layout(location = 5) in vec3 aDiffuse;
+layout(location = 6) in vec3 aSpecular;
+
+out vec2 TexCoords;
+
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 skyColor;
+    vec4 timeOfDay;
+} frame;
+
+// Instance transform as the top three rows of its affine matrix (see InstanceBuffer.h)
+layout(location = 7) in vec4 aInstanceRow0;
+layout(location = 8) in vec4 aInstanceRow1;
+layout(location = 9) in vec4 aInstanceRow2;
+
+// Packed meshes store positions as snorm16 relative to their bounds
+uniform vec3 posScale = vec3(1.0);
+uniform vec3 posOffset = vec3(0.0);
+
+void main()
+{
+	mat4 model = transpose(mat4(aInstanceRow0, aInstanceRow1, aInstanceRow2, vec4(0.0, 0.0, 0.0, 1.0)));
+	TexCoords = aTexCoord;
+	gl_Position = frame.viewProjection * model * vec4(aPos * posScale + posOffset, 1.0);
+}
\ No newline at end of file
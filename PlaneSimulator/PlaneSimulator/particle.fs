@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 Corner;
+in vec4 Color;
+out vec4 FragColor;
+
+void main()
+{
+    // Round sprite with a soft edge
+    float distance2 = dot(Corner, Corner);
+    if (distance2 > 1.0)
+        discard;
+    FragColor = vec4(Color.rgb, Color.a * (1.0 - distance2));
+}
@@ -0,0 +1,33 @@
+#version 330 core
+layout(location = 0) in vec2 aCorner;
+// Per instance (see ParticleRenderer.h)
+layout(location = 1) in vec4 aPositionSize;
+layout(location = 2) in vec4 aColor;
+layout(location = 3) in float aAge;
+
+out vec2 Corner;
+out vec4 Color;
+
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 skyColor;
+    vec4 timeOfDay;
+} frame;
+
+void main()
+{
+    // The rows of the view rotation are the camera's right and up axes in world space
+    vec3 right = vec3(frame.view[0][0], frame.view[1][0], frame.view[2][0]);
+    vec3 up = vec3(frame.view[0][1], frame.view[1][1], frame.view[2][1]);
+    vec3 position = aPositionSize.xyz + (right * aCorner.x + up * aCorner.y) * aPositionSize.w;
+
+    Corner = aCorner * 2.0;
+    Color = vec4(aColor.rgb, aColor.a * (1.0 - clamp(aAge, 0.0, 1.0)));
+    gl_Position = frame.viewProjection * vec4(position, 1.0);
+}
@@ -3,12 +3,22 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 skyColor;
+    vec4 timeOfDay;
+} frame;
 
 void main()
 {
-    vec4 pos = projection * view * vec4(aPos, 1.0);
+    // The sky stays centred on the camera: drop the view translation
+    vec4 pos = frame.projection * mat4(mat3(frame.view)) * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
     TexCoords = aPos;
 }   
\ No newline at end of file
@@ -0,0 +1,53 @@
+#version 330 core
+// Grid vertex in cells, 0..gridSize
+layout(location = 0) in vec2 aGrid;
+// Per chunk (see Terrain.h): world xz of the node's corner, size, level; morph start and end distance
+layout(location = 1) in vec4 aNode;
+layout(location = 2) in vec4 aMorph;
+
+out vec2 TexCoords;
+
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 skyColor;
+    vec4 timeOfDay;
+} frame;
+
+uniform sampler2D heightMap;
+uniform sampler2D texCoordMap;
+uniform bool hasTexCoordMap;
+// xy: world xz of the first sample, zw: world xz extent covered by the samples
+uniform vec4 field;
+uniform float spacing;
+uniform float gridSize;
+
+vec2 sampleUV(vec2 xz)
+{
+    // Sample centres sit on texel centres
+    vec2 texel = (xz - field.xy) / spacing + 0.5;
+    return texel / vec2(textureSize(heightMap, 0));
+}
+
+void main()
+{
+    float cell = aNode.z / gridSize;
+    vec2 xz = min(aNode.xy + aGrid * cell, field.xy + field.zw);
+    float height = textureLod(heightMap, sampleUV(xz), 0.0).r;
+
+    // Odd vertices slide onto their even neighbours as the chunk approaches the next coarser level
+    float distanceToCamera = distance(frame.cameraPosition.xyz, vec3(xz.x, height, xz.y));
+    float morph = clamp((distanceToCamera - aMorph.x) / (aMorph.y - aMorph.x), 0.0, 1.0);
+    vec2 odd = fract(aGrid * 0.5) * 2.0;
+    xz = min(xz - odd * cell * morph, field.xy + field.zw);
+
+    vec2 uv = sampleUV(xz);
+    height = textureLod(heightMap, uv, 0.0).r;
+    TexCoords = hasTexCoordMap ? textureLod(texCoordMap, uv, 0.0).rg : (xz - field.xy) / field.zw;
+    gl_Position = frame.viewProjection * vec4(xz.x, height, xz.y, 1.0);
+}
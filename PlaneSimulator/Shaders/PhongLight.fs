@@ -4,13 +4,26 @@ out vec4 FragColor;
 in vec3 Normal;  
 in vec3 FragPos;  
   
-uniform vec3 lightPos; 
-uniform vec3 viewPos; 
-uniform vec3 lightColor;
+layout(std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    vec4 lightPosition;
+    vec4 lightColor;
+    vec4 skyColor;
+    vec4 timeOfDay;
+} frame;
+
 uniform vec3 objectColor;
 
 void main()
 {
+    vec3 lightPos = frame.lightPosition.xyz;
+    vec3 viewPos = frame.cameraPosition.xyz;
+    vec3 lightColor = frame.lightColor.rgb;
+
 	// simple color blending
     //FragColor = vec4(lightColor * objectColor, 1.0);
 	